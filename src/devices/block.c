@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include "devices/ide.h"
 #include "threads/malloc.h"
+#include "threads/vaddr.h"
 
 /* A block device. */
 struct block
@@ -139,6 +140,120 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
   block->write_cnt++;
 }
 
+/* Reads CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes, as a single device request if the driver supports it.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multi (struct block *block, block_sector_t sector,
+                  block_sector_t cnt, void *buffer)
+{
+  uint8_t *p = buffer;
+  block_sector_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  if (block->ops->read_multi != NULL)
+    block->ops->read_multi (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      block->ops->read (block->aux, sector + i, p + i * BLOCK_SECTOR_SIZE);
+  block->read_cnt += cnt;
+}
+
+/* Writes CNT consecutive sectors starting at SECTOR to BLOCK from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes, as a
+   single device request if the driver supports it.  Returns after
+   the block device has acknowledged receiving the data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multi (struct block *block, block_sector_t sector,
+                   block_sector_t cnt, const void *buffer)
+{
+  const uint8_t *p = buffer;
+  block_sector_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  if (block->ops->write_multi != NULL)
+    block->ops->write_multi (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      block->ops->write (block->aux, sector + i, p + i * BLOCK_SECTOR_SIZE);
+  block->write_cnt += cnt;
+}
+
+/* Initializes R as a request to transfer CNT sectors starting
+   at SECTOR between a block device and BUFFER, writing to the
+   device if WRITE is true and reading from it otherwise.  If
+   COMPLETE is non-null, it will be called with R, which it can
+   get AUX from, when the request completes; otherwise, the
+   request must be waited for with block_wait().  A request must
+   be initialized again before each submission. */
+void
+block_request_init (struct block_request *r, bool write,
+                    block_sector_t sector, block_sector_t cnt,
+                    void *buffer, block_request_func *complete, void *aux)
+{
+  r->write = write;
+  r->sector = sector;
+  r->cnt = cnt;
+  r->buffer = buffer;
+  r->complete = complete;
+  r->aux = aux;
+  r->dev_sector = sector;
+  sema_init (&r->done, 0);
+}
+
+/* Submits request R to BLOCK.  If BLOCK's driver can queue
+   requests, returns at once, and R completes later, after the
+   requests submitted to BLOCK before it; otherwise, carries out
+   R and completes it before returning.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_submit (struct block *block, struct block_request *r)
+{
+  ASSERT (is_kernel_vaddr (r->buffer));
+
+  if (block->ops->submit == NULL || r->cnt == 0)
+    {
+      if (r->write)
+        block_write_multi (block, r->dev_sector, r->cnt, r->buffer);
+      else
+        block_read_multi (block, r->dev_sector, r->cnt, r->buffer);
+      block_request_done (r);
+      return;
+    }
+
+  check_sector (block, r->dev_sector);
+  check_sector (block, r->dev_sector + r->cnt - 1);
+  if (r->write)
+    {
+      ASSERT (block->type != BLOCK_FOREIGN);
+      block->write_cnt += r->cnt;
+    }
+  else
+    block->read_cnt += r->cnt;
+  block->ops->submit (block->aux, r);
+}
+
+/* Waits for request R, which must have been submitted without a
+   completion function, to complete. */
+void
+block_wait (struct block_request *r)
+{
+  ASSERT (r->complete == NULL);
+  sema_down (&r->done);
+}
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t
 block_size (struct block *block)
@@ -211,6 +326,18 @@ block_register (const char *name, enum block_type type,
   return block;
 }
 
+/* Called by a driver when it has carried out request R.  Calls
+   R's completion function, if it has one, or wakes up the thread
+   waiting for R.  May be called from an interrupt handler. */
+void
+block_request_done (struct block_request *r)
+{
+  if (r->complete != NULL)
+    r->complete (r);
+  else
+    sema_up (&r->done);
+}
+
 /* Returns the block device corresponding to LIST_ELEM, or a null
    pointer if LIST_ELEM is the list end of all_blocks. */
 static struct block *
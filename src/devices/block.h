@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 #include <inttypes.h>
+#include <list.h>
+#include "threads/synch.h"
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -53,22 +55,83 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multi (struct block *, block_sector_t, block_sector_t cnt,
+                       void *);
+void block_write_multi (struct block *, block_sector_t, block_sector_t cnt,
+                        const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous requests. */
+
+struct block_request;
+
+/* Called when a block request completes.  May be called from an
+   interrupt handler, so it must not sleep. */
+typedef void block_request_func (struct block_request *);
+
+/* A request to transfer CNT consecutive sectors between a block
+   device and BUFFER, submitted with block_submit() and completed
+   later, in the order submitted, while the submitting thread
+   carries on.  A request with a COMPLETE function is finished
+   when that function is called; the function may free or
+   resubmit the request.  A request without one must be waited
+   for with block_wait().
+
+   BUFFER must be in kernel memory, because the transfer may take
+   place while some other thread is running.  The request and
+   BUFFER must not be touched until the request completes. */
+struct block_request
+  {
+    bool write;                 /* Write to the device, or read? */
+    block_sector_t sector;      /* First sector. */
+    block_sector_t cnt;         /* Number of sectors. */
+    void *buffer;               /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    block_request_func *complete;  /* Called on completion, or null. */
+    void *aux;                  /* For use by COMPLETE. */
+
+    /* Owned by the block layer and drivers. */
+    block_sector_t dev_sector;  /* First sector on the device the
+                                   request has been passed to. */
+    struct list_elem elem;      /* Element in driver's queue. */
+    struct semaphore done;      /* Up'd on completion if no COMPLETE. */
+  };
+
+void block_request_init (struct block_request *, bool write,
+                         block_sector_t sector, block_sector_t cnt,
+                         void *buffer, block_request_func *, void *aux);
+void block_submit (struct block *, struct block_request *);
+void block_wait (struct block_request *);
+
 /* Statistics. */
 void block_print_stats (void);
 
 /* Lower-level interface to block device drivers. */
 
+/* Operations on a block device.  READ_MULTI and WRITE_MULTI
+   transfer CNT consecutive sectors in a single request.  They
+   may be null, in which case the sectors are transferred one at
+   a time with READ and WRITE.
+
+   SUBMIT queues a block_request, starting at its dev_sector, and
+   returns without waiting for it; the driver calls
+   block_request_done() when the request has been carried out.
+   It may be null, in which case block_submit() carries out the
+   request synchronously with the other operations. */
 struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+    void (*read_multi) (void *aux, block_sector_t, block_sector_t cnt,
+                        void *buffer);
+    void (*write_multi) (void *aux, block_sector_t, block_sector_t cnt,
+                         const void *buffer);
+    void (*submit) (void *aux, struct block_request *);
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
+void block_request_done (struct block_request *);
 
 #endif /* devices/block.h */
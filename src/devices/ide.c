@@ -3,15 +3,26 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
 #include "devices/partition.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].  Where the
+   controller supports PCI bus-master DMA, as the PIIX that QEMU
+   emulates does, data is transferred that way, following
+   [SFF-8038i]; otherwise, and as a fallback, it is transferred
+   by programmed I/O.
+
+   Transfers are queued: each disk has a queue of block requests,
+   which the interrupt handler works through, so that callers of
+   block_submit() need not wait for the disk. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -30,10 +41,25 @@
 #define reg_ctl(CHANNEL) ((CHANNEL)->reg_base + 0x206)  /* Control (w/o). */
 #define reg_alt_status(CHANNEL) reg_ctl (CHANNEL)       /* Alt Status (r/o). */
 
+/* Bus master IDE registers, relative to the channel's base. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
+/* Bus master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start transfer. */
+#define BM_CMD_READ 0x08        /* Transfer from disk to memory. */
+
+/* Bus master Status Register bits.  Writing 1 clears ERR and
+   INTR. */
+#define BM_STA_ERR 0x02         /* Transfer failed. */
+#define BM_STA_INTR 0x04        /* Disk raised an interrupt. */
+
 /* Alternate Status Register bits. */
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +75,26 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* PCI configuration space access ports. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* A physical region descriptor: one contiguous piece of memory
+   in a bus-master DMA transfer.  A PRD table is an array of
+   these, the last with PRD_EOT set in its flags. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Size in bytes, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT or 0. */
+  };
+#define PRD_EOT 0x8000          /* End of table. */
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +103,11 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    block_sector_t multiple;    /* Sectors per interrupt with READ/WRITE
+                                   MULTIPLE, or 0 if not enabled. */
+    bool dma;                   /* Use bus-master DMA? */
+    struct list queue;          /* Submitted block requests, oldest
+                                   first. */
   };
 
 /* An ATA channel (aka controller).
@@ -67,40 +118,81 @@ struct channel
     uint16_t reg_base;          /* Base I/O port. */
     uint8_t irq;                /* Interrupt in use. */
 
-    struct lock lock;           /* Must acquire to access the controller. */
-    bool expecting_interrupt;   /* True if an interrupt is expected, false if
-                                   any interrupt would be spurious. */
+    bool expecting_interrupt;   /* True if an interrupt is expected
+                                   outside of a request, false if any
+                                   such interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    uint16_t bm_base;           /* Bus master I/O base, 0 if no DMA. */
+    struct prd *prdt;           /* PRD table, one page. */
+
+    struct lock bounce_lock;    /* Must acquire to use BOUNCE. */
+    uint8_t *bounce;            /* Buffer for user memory transfers,
+                                   BOUNCE_SECTORS sectors. */
+
+    /* The request in progress is the first in BUSY's queue. */
+    struct ata_disk *busy;      /* Disk being served, or null if idle. */
+    int last_dev_no;            /* Device number of last disk served. */
+    block_sector_t req_ofs;     /* Sectors of the request done by
+                                   previous commands. */
+    block_sector_t cmd_cnt;     /* Sectors in the current command. */
+    block_sector_t cmd_ofs;     /* Sectors of it transferred by PIO. */
+    block_sector_t per_intr;    /* PIO sectors per interrupt. */
+    bool cmd_dma;               /* Is the current command by DMA? */
+
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
 
+/* If false, PIO transfers take an interrupt for every sector
+   even on disks that support READ/WRITE MULTIPLE. */
+bool ide_pio_multiple = true;
+
+/* If false, all transfers use PIO even where DMA is
+   available. */
+bool ide_dma = true;
+
 /* We support the two "legacy" ATA channels found in a standard PC. */
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* Size of each channel's bounce buffer. */
+#define BOUNCE_PAGES 8
+#define BOUNCE_SECTORS (BOUNCE_PAGES * PGSIZE / BLOCK_SECTOR_SIZE)
+
 static struct block_operations ide_operations;
 
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
+static void set_multiple_mode (struct ata_disk *, const uint16_t id[]);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void select_sector (struct ata_disk *, block_sector_t,
+                           block_sector_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void input_sectors (struct channel *, void *, block_sector_t cnt);
+static void output_sectors (struct channel *, const void *,
+                            block_sector_t cnt);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
+static uint8_t poll_status (struct channel *, bool data);
 static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
+static void start_next_request (struct channel *);
+static void start_command (struct channel *);
+static void continue_request (struct channel *);
+
+static uint16_t find_bus_master (void);
+static void build_prdt (struct channel *, const void *, size_t size);
+
 static void interrupt_handler (struct intr_frame *);
 
 /* Initialize the disk subsystem and detect disks. */
 void
 ide_init (void) 
 {
+  uint16_t bm_base = find_bus_master ();
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
@@ -123,9 +215,22 @@ ide_init (void)
         default:
           NOT_REACHED ();
         }
-      lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      lock_init (&c->bounce_lock);
+      c->bounce = palloc_get_multiple (PAL_ASSERT, BOUNCE_PAGES);
+      c->busy = NULL;
+      c->last_dev_no = 1;
+
+      /* Set up bus-master DMA, if the controller supports it. */
+      c->bm_base = 0;
+      c->prdt = NULL;
+      if (bm_base != 0)
+        {
+          c->prdt = palloc_get_page (0);
+          if (c->prdt != NULL)
+            c->bm_base = bm_base + chan_no * 8;
+        }
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +241,9 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple = 0;
+          d->dma = false;
+          list_init (&d->queue);
         }
 
       /* Register interrupt handler. */
@@ -279,7 +387,7 @@ identify_ata_device (struct ata_disk *d)
       d->is_ata = false;
       return;
     }
-  input_sector (c, id);
+  input_sectors (c, id, 1);
 
   /* Calculate capacity.
      Read model name and serial number. */
@@ -303,12 +411,46 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  set_multiple_mode (d, (const uint16_t *) id);
+
+  /* Use DMA if both the controller and the disk support it. */
+  d->dma = c->bm_base != 0 && (((const uint16_t *) id)[49] & 0x100) != 0;
+  if (d->dma)
+    strlcat (extra_info, ", DMA", sizeof extra_info);
+
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
   partition_scan (block);
 }
 
+/* Enables READ MULTIPLE and WRITE MULTIPLE on disk D, whose
+   IDENTIFY DEVICE response is ID, with as many sectors per
+   interrupt as the disk supports, and sets D's multiple member
+   to that number.  Leaves it 0 if the disk doesn't support the
+   commands or rejects SET MULTIPLE MODE. */
+static void
+set_multiple_mode (struct ata_disk *d, const uint16_t id[])
+{
+  struct channel *c = d->channel;
+  block_sector_t max = id[47] & 0xff;
+  block_sector_t cnt;
+
+  /* Use the largest power of 2 that the disk allows. */
+  if (max < 2)
+    return;
+  for (cnt = 1; cnt * 2 <= max; cnt *= 2)
+    continue;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), cnt);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_alt_status (c)) & STA_ERR) == 0)
+    d->multiple = cnt;
+}
+
 /* Translates STRING, which consists of SIZE bytes in a funky
    format, into a null-terminated string in-place.  Drops
    trailing whitespace and null bytes.  Returns STRING.  */
@@ -337,6 +479,105 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
+/* Maximum number of sectors in a single ATA command. */
+#define MAX_SECTORS 256
+
+/* Returns true if a transfer between disk D and BUFFER should
+   use DMA.  The buffer must be in kernel memory, which is
+   physically contiguous, and word-aligned. */
+static bool
+use_dma (struct ata_disk *d, const void *buffer)
+{
+  return (ide_dma && d->dma && is_kernel_vaddr (buffer)
+          && ((uintptr_t) buffer & 1) == 0);
+}
+
+/* Queues request R for disk D, starting it at once if D's
+   channel is idle.  R's buffer must be in kernel memory, because
+   the interrupt handler transfers the data, with whatever page
+   directory happens to be active. */
+static void
+ide_submit (void *d_, struct block_request *r)
+{
+  struct ata_disk *d = d_;
+  struct channel *c = d->channel;
+  enum intr_level old_level;
+
+  ASSERT (is_kernel_vaddr (r->buffer));
+  ASSERT (r->cnt > 0);
+
+  old_level = intr_disable ();
+  list_push_back (&d->queue, &r->elem);
+  if (c->busy == NULL)
+    start_next_request (c);
+  intr_set_level (old_level);
+}
+
+/* Transfers CNT sectors starting at SEC_NO between disk D and
+   BUFFER, writing to the disk if WRITE is true and reading from
+   it otherwise, and waits for the transfer to complete.  A
+   buffer in user memory is copied through D's channel's bounce
+   buffer, BOUNCE_SECTORS at a time. */
+static void
+transfer (struct ata_disk *d, bool write, block_sector_t sec_no,
+          block_sector_t cnt, void *buffer)
+{
+  struct channel *c = d->channel;
+  struct block_request r;
+  uint8_t *p = buffer;
+
+  if (is_kernel_vaddr (buffer))
+    {
+      block_request_init (&r, write, sec_no, cnt, buffer, NULL, NULL);
+      ide_submit (d, &r);
+      block_wait (&r);
+      return;
+    }
+
+  lock_acquire (&c->bounce_lock);
+  while (cnt > 0)
+    {
+      block_sector_t n = cnt < BOUNCE_SECTORS ? cnt : BOUNCE_SECTORS;
+      size_t size = n * BLOCK_SECTOR_SIZE;
+
+      if (write)
+        memcpy (c->bounce, p, size);
+      block_request_init (&r, write, sec_no, n, c->bounce, NULL, NULL);
+      ide_submit (d, &r);
+      block_wait (&r);
+      if (!write)
+        memcpy (p, c->bounce, size);
+      p += size;
+      sec_no += n;
+      cnt -= n;
+    }
+  lock_release (&c->bounce_lock);
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes, and
+   sleeps until the transfer completes.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read_multi (void *d_, block_sector_t sec_no, block_sector_t cnt,
+                void *buffer)
+{
+  transfer (d_, false, sec_no, cnt, buffer);
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes, and sleeps
+   until the disk has acknowledged receiving all of the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_write_multi (void *d_, block_sector_t sec_no, block_sector_t cnt,
+                 const void *buffer)
+{
+  transfer (d_, true, sec_no, cnt, (void *) buffer);
+}
+
 /* Reads sector SEC_NO from disk D into BUFFER, which must have
    room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to disks, so external
@@ -344,16 +585,7 @@ descramble_ata_string (char *string, int size)
 static void
 ide_read (void *d_, block_sector_t sec_no, void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
-  lock_release (&c->lock);
+  ide_read_multi (d_, sec_no, 1, buffer);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -364,36 +596,221 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
 static void
 ide_write (void *d_, block_sector_t sec_no, const void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+  ide_write_multi (d_, sec_no, 1, buffer);
 }
 
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multi,
+    ide_write_multi,
+    ide_submit
   };
 
+/* Request queue.
+
+   A channel carries out one request at a time, the oldest in the
+   queue of its busy disk, taking its two disks in turn when both
+   have requests waiting.  A request is started by the thread
+   that submits it, if the channel is idle, and otherwise by the
+   interrupt handler when the request ahead of it completes.  The
+   interrupt handler then carries it on, issuing one command for
+   every MAX_SECTORS sectors.  By DMA, the disk raises a single
+   interrupt at the end of each command.  By PIO, it raises one
+   for each block of D->multiple sectors with READ/WRITE MULTIPLE,
+   or for each sector otherwise, and the interrupt handler copies
+   the data.  All of this runs with interrupts off, so none of it
+   may sleep. */
+
+/* Returns the request in progress on channel C. */
+static struct block_request *
+current_request (struct channel *c)
+{
+  return list_entry (list_front (&c->busy->queue),
+                     struct block_request, elem);
+}
+
+/* Starts the oldest request of the disk on channel C after the
+   one served last that has any, or marks C idle if neither
+   has. */
+static void
+start_next_request (struct channel *c)
+{
+  int i;
+
+  for (i = 1; i <= 2; i++)
+    {
+      struct ata_disk *d = &c->devices[(c->last_dev_no + i) % 2];
+      if (!list_empty (&d->queue))
+        {
+          c->busy = d;
+          c->last_dev_no = d->dev_no;
+          c->req_ofs = 0;
+          start_command (c);
+          return;
+        }
+    }
+  c->busy = NULL;
+}
+
+/* Returns the number of sectors in the next block of the PIO
+   command in progress on channel C. */
+static block_sector_t
+pio_block_cnt (const struct channel *c)
+{
+  block_sector_t left = c->cmd_cnt - c->cmd_ofs;
+  return left < c->per_intr ? left : c->per_intr;
+}
+
+/* Waits for the disk on channel C to ask for data and sends it
+   the next block of R, the PIO write in progress. */
+static void
+output_block (struct channel *c, struct block_request *r)
+{
+  block_sector_t ofs = c->req_ofs + c->cmd_ofs;
+
+  if ((poll_status (c, true) & (STA_DRQ | STA_ERR)) != STA_DRQ)
+    PANIC ("%s: disk write failed, sector=%"PRDSNu,
+           c->busy->name, r->dev_sector + ofs);
+  output_sectors (c, (uint8_t *) r->buffer + ofs * BLOCK_SECTOR_SIZE,
+                  pio_block_cnt (c));
+}
+
+/* Issues the command for the next MAX_SECTORS or fewer sectors of
+   the request in progress on channel C, by DMA if possible and
+   otherwise by PIO, in which case a write also sends the first
+   block of data. */
+static void
+start_command (struct channel *c)
+{
+  struct ata_disk *d = c->busy;
+  struct block_request *r = current_request (c);
+  block_sector_t sec_no = r->dev_sector + c->req_ofs;
+  uint8_t *p = (uint8_t *) r->buffer + c->req_ofs * BLOCK_SECTOR_SIZE;
+  block_sector_t left = r->cnt - c->req_ofs;
+
+  c->cmd_cnt = left < MAX_SECTORS ? left : MAX_SECTORS;
+  c->cmd_ofs = 0;
+  c->cmd_dma = use_dma (d, p);
+  if (c->cmd_dma)
+    {
+      uint8_t direction = r->write ? 0 : BM_CMD_READ;
+
+      build_prdt (c, p, c->cmd_cnt * BLOCK_SECTOR_SIZE);
+      outl (reg_bm_prdt (c), vtop (c->prdt));
+      outb (reg_bm_command (c), direction);
+      outb (reg_bm_status (c), BM_STA_ERR | BM_STA_INTR);
+
+      select_sector (d, sec_no, c->cmd_cnt);
+      outb (reg_command (c), r->write ? CMD_WRITE_DMA : CMD_READ_DMA);
+      outb (reg_bm_command (c), direction | BM_CMD_START);
+    }
+  else
+    {
+      uint8_t command;
+
+      c->per_intr = ide_pio_multiple && d->multiple ? d->multiple : 1;
+      if (c->per_intr > 1)
+        command = r->write ? CMD_WRITE_MULTIPLE : CMD_READ_MULTIPLE;
+      else
+        command = r->write ? CMD_WRITE_SECTOR_RETRY : CMD_READ_SECTOR_RETRY;
+
+      select_sector (d, sec_no, c->cmd_cnt);
+      outb (reg_command (c), command);
+      if (r->write)
+        output_block (c, r);
+    }
+}
+
+/* Carries on with the request in progress on channel C after its
+   disk has raised an interrupt.  When the request's last command
+   is done, starts the next request and then completes this
+   one. */
+static void
+continue_request (struct channel *c)
+{
+  struct ata_disk *d = c->busy;
+  struct block_request *r = current_request (c);
+  uint8_t status = poll_status (c, false);
+
+  inb (reg_status (c));                 /* Acknowledge interrupt. */
+  if (c->cmd_dma)
+    {
+      uint8_t bm_status = inb (reg_bm_status (c));
+
+      outb (reg_bm_command (c), r->write ? 0 : BM_CMD_READ);
+      outb (reg_bm_status (c), BM_STA_ERR | BM_STA_INTR);
+      if ((bm_status & BM_STA_ERR) != 0
+          || (status & (STA_BSY | STA_DRQ | STA_ERR)) != 0)
+        {
+          /* Turn off DMA for D and redo the command by PIO. */
+          printf ("%s: DMA %s failed, sector=%"PRDSNu", using PIO\n",
+                  d->name, r->write ? "write" : "read",
+                  r->dev_sector + c->req_ofs);
+          d->dma = false;
+          start_command (c);
+          return;
+        }
+      c->cmd_ofs = c->cmd_cnt;
+    }
+  else
+    {
+      block_sector_t ofs = c->req_ofs + c->cmd_ofs;
+      block_sector_t blk = pio_block_cnt (c);
+
+      if (r->write)
+        {
+          /* The disk has written the block we sent last. */
+          if ((status & (STA_BSY | STA_ERR)) != 0)
+            PANIC ("%s: disk write failed, sector=%"PRDSNu,
+                   d->name, r->dev_sector + ofs);
+          c->cmd_ofs += blk;
+          if (c->cmd_ofs < c->cmd_cnt)
+            {
+              output_block (c, r);
+              return;
+            }
+        }
+      else
+        {
+          /* The disk has a block ready for us. */
+          if ((status & (STA_BSY | STA_DRQ | STA_ERR)) != STA_DRQ)
+            PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                   d->name, r->dev_sector + ofs);
+          input_sectors (c, (uint8_t *) r->buffer + ofs * BLOCK_SECTOR_SIZE,
+                         blk);
+          c->cmd_ofs += blk;
+          if (c->cmd_ofs < c->cmd_cnt)
+            return;
+        }
+    }
+
+  c->req_ofs += c->cmd_cnt;
+  if (c->req_ofs < r->cnt)
+    start_command (c);
+  else
+    {
+      list_pop_front (&d->queue);
+      start_next_request (c);
+      block_request_done (r);
+    }
+}
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the number of sectors CNT, which must be
+   between 1 and MAX_SECTORS, to the disk's sector selection
+   registers.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, block_sector_t cnt)
 {
   struct channel *c = d->channel;
 
-  ASSERT (sec_no < (1UL << 28));
+  ASSERT (sec_no + cnt <= (1UL << 28));
+  ASSERT (cnt > 0 && cnt <= MAX_SECTORS);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt == MAX_SECTORS ? 0 : cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -414,20 +831,108 @@ issue_pio_command (struct channel *c, uint8_t command)
   outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for BLOCK_SECTOR_SIZE bytes. */
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTORS, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-input_sector (struct channel *c, void *sector) 
+input_sectors (struct channel *c, void *sectors, block_sector_t cnt) 
 {
-  insw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  insw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain BLOCK_SECTOR_SIZE bytes. */
+/* Writes CNT sectors from SECTORS to channel C's data register in
+   PIO mode.  SECTORS must contain CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-output_sector (struct channel *c, const void *sector) 
+output_sectors (struct channel *c, const void *sectors, block_sector_t cnt) 
 {
-  outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  outsw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
+}
+
+/* Bus-master DMA. */
+
+/* Reads the 32-bit register REG from the configuration space of
+   PCI device DEV, function FUNC, on bus 0. */
+static uint32_t
+pci_read_config (int dev, int func, int reg)
+{
+  outl (PCI_CONFIG_ADDR, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes VALUE to the 32-bit register REG in the configuration
+   space of PCI device DEV, function FUNC, on bus 0. */
+static void
+pci_write_config (int dev, int func, int reg, uint32_t value)
+{
+  outl (PCI_CONFIG_ADDR, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks on PCI bus 0 for an IDE controller that drives the
+   legacy channels and can act as a bus master, such as the PIIX,
+   and enables bus mastering on it.  Returns the base I/O port of
+   its bus master registers, or 0 if there is no such
+   controller. */
+static uint16_t
+find_bus_master (void)
+{
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++)
+      {
+        uint32_t id = pci_read_config (dev, func, 0x00);
+        uint32_t class = pci_read_config (dev, func, 0x08);
+        uint32_t bar4;
+
+        /* Mass storage (01), IDE (01), legacy mode on both
+           channels, bus master capable. */
+        if ((id & 0xffff) == 0xffff
+            || (class >> 16) != 0x0101
+            || (class & 0x0500) != 0
+            || (class & 0x8000) == 0)
+          continue;
+
+        /* BAR 4 holds the bus master registers, in I/O space. */
+        bar4 = pci_read_config (dev, func, 0x20);
+        if ((bar4 & 1) == 0 || (bar4 & 0xfffc) == 0)
+          continue;
+
+        /* Enable I/O space decoding and bus mastering. */
+        pci_write_config (dev, func, 0x04,
+                          pci_read_config (dev, func, 0x04) | 0x05);
+        return bar4 & 0xfffc;
+      }
+  return 0;
+}
+
+/* Fills in channel C's PRD table to describe the SIZE bytes at
+   BUFFER, which must be physically contiguous, as kernel memory
+   is.  A region may not cross a 64 kB boundary. */
+static void
+build_prdt (struct channel *c, const void *buffer, size_t size)
+{
+  uintptr_t addr = vtop (buffer);
+  struct prd *prd = c->prdt;
+
+  ASSERT (size > 0);
+  while (size > 0)
+    {
+      size_t chunk = 0x10000 - (addr & 0xffff);
+      if (chunk > size)
+        chunk = size;
+
+      ASSERT (prd < c->prdt + PGSIZE / sizeof *prd);
+      prd->addr = addr;
+      prd->size = chunk;
+      prd->flags = 0;
+      prd++;
+
+      addr += chunk;
+      size -= chunk;
+    }
+  prd[-1].flags = PRD_EOT;
 }
 
 /* Low-level ATA primitives. */
@@ -446,7 +951,7 @@ wait_until_idle (const struct ata_disk *d)
     {
       if ((inb (reg_status (d->channel)) & (STA_BSY | STA_DRQ)) == 0)
         return;
-      timer_usleep (10);
+      timer_udelay (10);
     }
 
   printf ("%s: idle timeout\n", d->name);
@@ -479,6 +984,27 @@ wait_while_busy (const struct ata_disk *d)
   return false;
 }
 
+/* Waits up to a second, without sleeping, for channel C's
+   selected disk to clear BSY and, if DATA is true, to set DRQ or
+   ERR.  Returns the disk's status at the end of the wait.  For
+   use with interrupts off. */
+static uint8_t
+poll_status (struct channel *c, bool data)
+{
+  uint8_t status = 0;
+  int i;
+
+  for (i = 0; i < 100000; i++)
+    {
+      status = inb (reg_alt_status (c));
+      if ((status & STA_BSY) == 0
+          && (!data || (status & (STA_DRQ | STA_ERR)) != 0))
+        break;
+      timer_udelay (10);
+    }
+  return status;
+}
+
 /* Program D's channel so that D is now the selected disk. */
 static void
 select_device (const struct ata_disk *d)
@@ -489,7 +1015,7 @@ select_device (const struct ata_disk *d)
     dev |= DEV_DEV;
   outb (reg_device (c), dev);
   inb (reg_alt_status (c));
-  timer_nsleep (400);
+  timer_ndelay (400);
 }
 
 /* Select disk D in its channel, as select_device(), but wait for
@@ -511,9 +1037,12 @@ interrupt_handler (struct intr_frame *f)
   for (c = channels; c < channels + CHANNEL_CNT; c++)
     if (f->vec_no == c->irq)
       {
-        if (c->expecting_interrupt) 
+        if (c->busy != NULL)
+          continue_request (c);
+        else if (c->expecting_interrupt) 
           {
             inb (reg_status (c));               /* Acknowledge interrupt. */
+            c->expecting_interrupt = false;
             sema_up (&c->completion_wait);      /* Wake up waiter. */
           }
         else
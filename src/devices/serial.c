@@ -129,6 +129,45 @@ serial_putc (uint8_t byte)
   intr_set_level (old_level);
 }
 
+/* Sends the N bytes in BUFFER to the serial port, like N calls
+   to serial_putc() but disabling interrupts and updating the
+   interrupt enable register only once, not for every byte. */
+void
+serial_putbuf (const void *buffer_, size_t n) 
+{
+  const uint8_t *buffer = buffer_;
+  enum intr_level old_level = intr_disable ();
+
+  if (mode != QUEUE)
+    {
+      if (mode == UNINIT)
+        init_poll ();
+      while (n-- > 0)
+        putc_poll (*buffer++); 
+    }
+  else 
+    {
+      while (n-- > 0) 
+        {
+          if (intq_full (&txq)) 
+            {
+              /* As in serial_putc(), poll if interrupts are off.
+                 Otherwise, make sure the transmit interrupt is
+                 enabled, so that the queue drains while we wait
+                 for room. */
+              if (old_level == INTR_OFF)
+                putc_poll (intq_getc (&txq)); 
+              else
+                write_ier ();
+            }
+          intq_putc (&txq, *buffer++); 
+        }
+      write_ier ();
+    }
+  
+  intr_set_level (old_level);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
    mode. */
 void
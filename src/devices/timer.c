@@ -24,11 +24,35 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* A divisor D and its reciprocal MULT = ceil(2**(32 + SHIFT) / D),
+   where 2**SHIFT >= D, so that MULT has at most 33 bits.  For
+   any 32-bit X, X / D = (X * MULT) >> (32 + SHIFT), which costs a
+   multiplication and a shift instead of a call to __divdi3(). */
+struct reciprocal
+  {
+    int32_t divisor;
+    uint64_t mult;
+    int shift;
+  };
+#define RECIPROCAL(D, SHIFT) \
+        {(D), ((1ULL << (32 + (SHIFT))) - 1) / (D) + 1, (SHIFT)}
+
+/* Reciprocals of the divisors used by real_time_sleep() and
+   real_time_delay(). */
+static const struct reciprocal reciprocals[] =
+  {
+    RECIPROCAL (1, 0),
+    RECIPROCAL (1000, 10),
+    RECIPROCAL (1000 * 1000, 20),
+    RECIPROCAL (1000 * 1000 * 1000, 30),
+  };
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static int64_t divide (int64_t x, int32_t d);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
@@ -219,7 +243,7 @@ real_time_sleep (int64_t num, int32_t denom)
      ---------------------- = NUM * TIMER_FREQ / DENOM ticks. 
      1 s / TIMER_FREQ ticks
   */
-  int64_t ticks = num * TIMER_FREQ / denom;
+  int64_t ticks = divide (num * TIMER_FREQ, denom);
 
   ASSERT (intr_get_level () == INTR_ON);
   if (ticks > 0)
@@ -244,5 +268,31 @@ real_time_delay (int64_t num, int32_t denom)
   /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
   ASSERT (denom % 1000 == 0);
-  busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
+  busy_wait (divide (divide (loops_per_tick * num, 1000) * TIMER_FREQ,
+                     denom / 1000)); 
+}
+
+/* Returns X / D, rounded toward zero.  If X fits in 32 bits and
+   D is in reciprocals[], as it is for all but the longest sleeps
+   and delays, multiplies by the reciprocal of D instead of
+   dividing. */
+static int64_t
+divide (int64_t x, int32_t d) 
+{
+  if (x >= 0 && x <= UINT32_MAX)
+    {
+      const struct reciprocal *r;
+
+      for (r = reciprocals;
+           r < reciprocals + sizeof reciprocals / sizeof *reciprocals; r++)
+        if (r->divisor == d)
+          {
+            uint32_t x0 = x;
+            uint64_t hi = ((uint64_t) x0 * (uint32_t) r->mult) >> 32;
+            if (r->mult >> 32)
+              hi += x0;
+            return hi >> r->shift;
+          }
+    }
+  return x / d;
 }
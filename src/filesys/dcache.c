@@ -0,0 +1,248 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Directory entry cache.
+
+   Remembers the results of recent directory lookups, keyed by
+   the inode sector of the directory searched and the name looked
+   up, so that walking a path that was walked recently does not
+   read any directory.  A positive entry keeps the inode it names
+   open, so that opening it again does not read the inode either.
+   A negative entry records that the name does not exist.
+
+   The cache holds at most DCACHE_SIZE entries; adding another
+   evicts the least recently used.
+
+   Directory operations keep the cache coherent: they add entries
+   for what they find, and drop or replace entries for names they
+   add or remove, all while holding the directory's lock. */
+#define DCACHE_SIZE 256
+
+/* A cached directory lookup. */
+struct dentry
+  {
+    struct hash_elem hash_elem;         /* Element in dentries. */
+    struct list_elem lru_elem;          /* Element in lru. */
+    block_sector_t parent;              /* Directory's inode sector. */
+    char name[NAME_MAX + 1];            /* Name looked up. */
+    struct inode *inode;                /* Inode found, or null. */
+  };
+
+static struct hash dentries;            /* All entries. */
+static struct list lru;                 /* Entries, most recently used first. */
+static struct lock dcache_lock;         /* Protects all of the above. */
+
+/* Statistics. */
+static unsigned long long hit_cnt;      /* Lookups answered. */
+static unsigned long long miss_cnt;     /* Lookups not answered. */
+
+static hash_hash_func dentry_hash;
+static hash_less_func dentry_less;
+static struct dentry *find (block_sector_t parent, const char *name);
+static struct inode *drop (struct dentry *);
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void)
+{
+  if (!hash_init (&dentries, dentry_hash, dentry_less, NULL))
+    PANIC ("can't create directory entry cache");
+  list_init (&lru);
+  lock_init (&dcache_lock);
+}
+
+/* Looks up NAME in the directory whose inode is in sector
+   PARENT.  If the cache knows the answer, returns true and sets
+   *INODE to a newly opened inode for NAME, which the caller must
+   close, or to a null pointer if NAME does not exist.  Returns
+   false if the cache does not know. */
+bool
+dcache_lookup (block_sector_t parent, const char *name, struct inode **inode)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return false;
+
+  lock_acquire (&dcache_lock);
+  d = find (parent, name);
+  if (d != NULL)
+    {
+      list_remove (&d->lru_elem);
+      list_push_front (&lru, &d->lru_elem);
+      *inode = inode_reopen (d->inode);
+      hit_cnt++;
+    }
+  else
+    miss_cnt++;
+  lock_release (&dcache_lock);
+
+  return d != NULL;
+}
+
+/* Records that NAME in the directory whose inode is in sector
+   PARENT is INODE, or does not exist if INODE is a null pointer.
+   The caller keeps its own reference to INODE. */
+void
+dcache_add (block_sector_t parent, const char *name, struct inode *inode)
+{
+  struct inode *old = NULL;
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  d = find (parent, name);
+  if (d != NULL)
+    {
+      /* Replace the existing entry. */
+      old = d->inode;
+      list_remove (&d->lru_elem);
+    }
+  else
+    {
+      /* Make a new entry, reusing the least recently used one if
+         the cache is full. */
+      if (hash_size (&dentries) >= DCACHE_SIZE)
+        {
+          d = list_entry (list_back (&lru), struct dentry, lru_elem);
+          old = drop (d);
+        }
+      else
+        {
+          d = malloc (sizeof *d);
+          if (d == NULL)
+            {
+              lock_release (&dcache_lock);
+              return;
+            }
+        }
+      d->parent = parent;
+      strlcpy (d->name, name, sizeof d->name);
+      hash_insert (&dentries, &d->hash_elem);
+    }
+  d->inode = inode_reopen (inode);
+  list_push_front (&lru, &d->lru_elem);
+  lock_release (&dcache_lock);
+
+  /* Closing may write to disk, so do it outside the lock. */
+  inode_close (old);
+}
+
+/* Forgets anything known about NAME in the directory whose inode
+   is in sector PARENT. */
+void
+dcache_remove (block_sector_t parent, const char *name)
+{
+  struct inode *old = NULL;
+  struct dentry *d;
+
+  lock_acquire (&dcache_lock);
+  d = find (parent, name);
+  if (d != NULL)
+    {
+      old = drop (d);
+      free (d);
+    }
+  lock_release (&dcache_lock);
+
+  inode_close (old);
+}
+
+/* Forgets every entry for the directory whose inode is in sector
+   PARENT, which is being removed.  Its entries must not outlive
+   it, in case its sector is reused for another directory. */
+void
+dcache_purge (block_sector_t parent)
+{
+  struct list doomed;
+  struct list_elem *e, *next;
+
+  list_init (&doomed);
+  lock_acquire (&dcache_lock);
+  for (e = list_begin (&lru); e != list_end (&lru); e = next)
+    {
+      struct dentry *d = list_entry (e, struct dentry, lru_elem);
+      next = list_next (e);
+      if (d->parent == parent)
+        {
+          hash_delete (&dentries, &d->hash_elem);
+          list_remove (&d->lru_elem);
+          list_push_back (&doomed, &d->lru_elem);
+        }
+    }
+  lock_release (&dcache_lock);
+
+  while (!list_empty (&doomed))
+    {
+      struct dentry *d = list_entry (list_pop_front (&doomed),
+                                     struct dentry, lru_elem);
+      inode_close (d->inode);
+      free (d);
+    }
+}
+
+/* Prints directory entry cache statistics. */
+void
+dcache_print_stats (void)
+{
+  printf ("Directory cache: %llu hits, %llu misses\n", hit_cnt, miss_cnt);
+}
+
+/* Returns a hash value for the dentry that contains E. */
+static unsigned
+dentry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+  return hash_string (d->name) ^ hash_int (d->parent);
+}
+
+/* Returns true if dentry A precedes dentry B. */
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+  const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+  if (a->parent != b->parent)
+    return a->parent < b->parent;
+  return strcmp (a->name, b->name) < 0;
+}
+
+/* Returns the entry for NAME, which must be at most NAME_MAX
+   characters long, in PARENT, or a null pointer if there is
+   none.  The cache lock must be held. */
+static struct dentry *
+find (block_sector_t parent, const char *name)
+{
+  struct dentry key;
+  struct hash_elem *e;
+
+  key.parent = parent;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dentries, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Removes D from the cache, without freeing it, and returns its
+   inode, which the caller must close once it has released the
+   cache lock. */
+static struct inode *
+drop (struct dentry *d)
+{
+  struct inode *inode = d->inode;
+
+  hash_delete (&dentries, &d->hash_elem);
+  list_remove (&d->lru_elem);
+  d->inode = NULL;
+  return inode;
+}
@@ -0,0 +1,17 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+struct inode;
+
+void dcache_init (void);
+bool dcache_lookup (block_sector_t parent, const char *name,
+                    struct inode **);
+void dcache_add (block_sector_t parent, const char *name, struct inode *);
+void dcache_remove (block_sector_t parent, const char *name);
+void dcache_purge (block_sector_t parent);
+void dcache_print_stats (void);
+
+#endif /* filesys/dcache.h */
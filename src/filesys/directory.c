@@ -1,12 +1,22 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include <round.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 
-/* A directory. */
+/* A directory.
+   Operations on its entries hold its inode's directory lock,
+   taken with inode_lock(), for their whole duration.
+
+   Every directory has entries named "." and "..", for itself and
+   its parent, which are looked up like any other but cannot be
+   removed and are not reported by dir_readdir().  The root
+   directory is its own parent. */
 struct dir 
   {
     struct inode *inode;                /* Backing store. */
@@ -21,24 +31,98 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* Hashed directory index.
+
+   Small directories are a flat array of `struct dir_entry's that
+   is searched linearly.  Once a directory holds more than
+   DIR_LINEAR_MAX entries it is converted into an extendible hash
+   index, so that lookups, additions and removals read a constant
+   number of sectors regardless of the directory's size.
+
+   An indexed directory file is laid out as follows:
+
+      - A `struct dx_header' at offset 0.  Its magic number sits
+        where a linear directory keeps the inode sector of its
+        first entry, which can never be that large, so the two
+        formats cannot be confused.
+
+      - The bucket table at DX_TABLE_OFS: an array of 1 << depth
+        bucket numbers, indexed by the low DEPTH bits of a name's
+        hash.  Several slots may name the same bucket.
+
+      - The buckets, one sector each, starting at DX_BUCKET_OFS.
+
+   A full bucket is split in two, doubling the table first if the
+   bucket is already distinguished by all DEPTH bits.  Buckets
+   are never merged; removed entries just leave a free slot. */
+#define DIR_LINEAR_MAX 25               /* Entries before indexing. */
+#define DX_MAGIC 0x58444e49             /* Identifies a hashed index. */
+#define DX_MAX_DEPTH 10                 /* Largest table is 1024 slots. */
+#define DX_TABLE_OFS 16                 /* Offset of bucket table. */
+#define DX_BUCKET_OFS ROUND_UP (DX_TABLE_OFS + (2 << DX_MAX_DEPTH), \
+                                BLOCK_SECTOR_SIZE)
+#define DX_BUCKET_ENTRIES 25            /* Entries per bucket. */
+
+/* Header of a hashed directory. */
+struct dx_header
+  {
+    uint32_t magic;                     /* DX_MAGIC. */
+    uint32_t depth;                     /* Global depth of the table. */
+    uint32_t bucket_cnt;                /* Number of buckets. */
+  };
+
+/* A hash bucket.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct dx_bucket
+  {
+    uint16_t depth;                     /* Number of hash bits in use. */
+    uint16_t unused0;                   /* Not used. */
+    struct dir_entry entries[DX_BUCKET_ENTRIES];
+    uint8_t unused[8];                  /* Not used. */
+  };
+
+static bool dx_read_header (const struct dir *, struct dx_header *);
+static bool dx_lookup (const struct dir *, const struct dx_header *,
+                       const char *name, struct dir_entry *, off_t *);
+static bool dx_add (struct dir *, struct dx_header *,
+                    const struct dir_entry *);
+static bool dx_convert (struct dir *, struct dx_header *);
+static off_t dx_entry_ofs (off_t);
+static bool is_dot (const char *name);
+static bool read_next (struct dir *, bool indexed, struct dir_entry *);
+static bool is_empty (struct inode *);
+
 /* Creates a directory with space for ENTRY_CNT entries in the
-   given SECTOR.  Returns true if successful, false on failure. */
+   given SECTOR, whose parent directory's inode is in sector
+   PARENT.  Returns true if successful, false on failure. */
 bool
-dir_create (block_sector_t sector, size_t entry_cnt)
+dir_create (block_sector_t sector, block_sector_t parent, size_t entry_cnt)
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  struct dir *dir;
+  bool success;
+
+  if (!inode_create (sector, entry_cnt * sizeof (struct dir_entry), true))
+    return false;
+  dir = dir_open (inode_open (sector));
+  success = (dir != NULL
+             && dir_add (dir, ".", sector)
+             && dir_add (dir, "..", parent));
+  dir_close (dir);
+  return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
-   it takes ownership.  Returns a null pointer on failure. */
+   it takes ownership.  Returns a null pointer on failure,
+   including if INODE is not a directory. */
 struct dir *
 dir_open (struct inode *inode) 
 {
   struct dir *dir = calloc (1, sizeof *dir);
-  if (inode != NULL && dir != NULL)
+  if (inode != NULL && dir != NULL && inode_is_dir (inode))
     {
       dir->inode = inode;
       dir->pos = 0;
+      inode_set_metadata (inode);
       return dir;
     }
   else
@@ -92,12 +176,16 @@ static bool
 lookup (const struct dir *dir, const char *name,
         struct dir_entry *ep, off_t *ofsp) 
 {
+  struct dx_header h;
   struct dir_entry e;
   size_t ofs;
   
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  if (dx_read_header (dir, &h))
+    return dx_lookup (dir, &h, name, ep, ofsp);
+
   for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
        ofs += sizeof e) 
     if (e.in_use && !strcmp (name, e.name)) 
@@ -114,20 +202,41 @@ lookup (const struct dir *dir, const char *name,
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
-   a null pointer.  The caller must close *INODE. */
+   a null pointer.  The caller must close *INODE.
+   Answers from the directory entry cache if possible, and
+   otherwise adds the answer to it. */
 bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
+  block_sector_t sector;
   struct dir_entry e;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  sector = inode_get_inumber (dir->inode);
+  if (dcache_lookup (sector, name, inode))
+    return *inode != NULL;
+
+  /* The cache is updated under the directory lock, so that it
+     cannot miss a concurrent change to the directory.  Nothing
+     is cached for a removed directory, whose entries have already
+     been purged from the cache. */
+  inode_lock (dir->inode);
   if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
+    {
+      *inode = inode_open (e.inode_sector);
+      if (*inode != NULL && !inode_is_removed (dir->inode))
+        dcache_add (sector, name, *inode);
+    }
   else
-    *inode = NULL;
+    {
+      *inode = NULL;
+      if (!inode_is_removed (dir->inode))
+        dcache_add (sector, name, NULL);
+    }
+  inode_unlock (dir->inode);
 
   return *inode != NULL;
 }
@@ -136,13 +245,14 @@ dir_lookup (const struct dir *dir, const char *name,
    file by that name.  The file's inode is in sector
    INODE_SECTOR.
    Returns true if successful, false on failure.
-   Fails if NAME is invalid (i.e. too long) or a disk or memory
-   error occurs. */
+   Fails if NAME is invalid (i.e. too long), DIR has been
+   removed, or a disk or memory error occurs. */
 bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 {
+  struct dx_header h;
   struct dir_entry e;
-  off_t ofs;
+  off_t ofs = 0;
   bool success = false;
 
   ASSERT (dir != NULL);
@@ -152,8 +262,9 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
-  /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL))
+  /* Check that DIR still exists and NAME is not in use. */
+  inode_lock (dir->inode);
+  if (inode_is_removed (dir->inode) || lookup (dir, name, NULL, NULL))
     goto done;
 
   /* Set OFS to offset of free slot.
@@ -162,55 +273,91 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
      
      inode_read_at() will only return a short read at end of file.
      Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
+     read due to something intermittent such as low memory.
 
-  /* Write slot. */
+     Hashed directories find their own slot instead. */
+  if (!dx_read_header (dir, &h))
+    for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+         ofs += sizeof e) 
+      if (!e.in_use)
+        break;
+
+  /* Write slot, switching to a hashed index instead of growing a
+     large linear directory any further. */
   e.in_use = true;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
-  success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  if (h.magic == DX_MAGIC)
+    success = dx_add (dir, &h, &e);
+  else if (ofs / (off_t) sizeof e >= DIR_LINEAR_MAX)
+    success = dx_convert (dir, &h) && dx_add (dir, &h, &e);
+  else
+    success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+
+  /* Forget that NAME did not exist. */
+  if (success)
+    dcache_remove (inode_get_inumber (dir->inode), name);
 
  done:
+  inode_unlock (dir->inode);
   return success;
 }
 
 /* Removes any entry for NAME in DIR.
    Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   which occurs only if there is no file with the given NAME, if
+   NAME is "." or "..", or if NAME is a directory that is not
+   empty. */
 bool
 dir_remove (struct dir *dir, const char *name) 
 {
   struct dir_entry e;
   struct inode *inode = NULL;
+  bool is_dir = false;
   bool success = false;
   off_t ofs;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  if (is_dot (name))
+    return false;
+
   /* Find directory entry. */
+  inode_lock (dir->inode);
   if (!lookup (dir, name, &e, &ofs))
     goto done;
 
-  /* Open inode. */
+  /* Open inode.  A directory must be empty, and stays locked
+     until it is removed, so that nothing can be added to it in
+     the meantime. */
   inode = inode_open (e.inode_sector);
   if (inode == NULL)
     goto done;
+  is_dir = inode_is_dir (inode);
+  if (is_dir)
+    {
+      inode_lock (inode);
+      if (!is_empty (inode))
+        goto done;
+    }
 
   /* Erase directory entry. */
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
     goto done;
+  dcache_add (inode_get_inumber (dir->inode), name, NULL);
 
   /* Remove inode. */
   inode_remove (inode);
+  if (is_dir)
+    dcache_purge (inode_get_inumber (inode));
   success = true;
 
  done:
+  if (is_dir)
+    inode_unlock (inode);
+  inode_unlock (dir->inode);
   inode_close (inode);
   return success;
 }
@@ -221,16 +368,324 @@ dir_remove (struct dir *dir, const char *name)
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
+  struct dx_header h;
+  struct dir_entry e;
+  bool found;
+
+  inode_lock (dir->inode);
+  found = read_next (dir, dx_read_header (dir, &h), &e);
+  if (found)
+    strlcpy (name, e.name, NAME_MAX + 1);
+  inode_unlock (dir->inode);
+  return found;
+}
+
+/* Returns true if NAME is "." or "..". */
+static bool
+is_dot (const char *name)
+{
+  return !strcmp (name, ".") || !strcmp (name, "..");
+}
+
+/* Reads the next entry in DIR other than "." and ".." into *EP,
+   advancing DIR's position past it.  INDEXED says whether DIR is
+   hashed.  Returns true if successful, false if the directory
+   contains no more entries. */
+static bool
+read_next (struct dir *dir, bool indexed, struct dir_entry *ep)
+{
+  for (;;)
+    {
+      if (indexed)
+        dir->pos = dx_entry_ofs (dir->pos);
+      if (inode_read_at (dir->inode, ep, sizeof *ep, dir->pos) != sizeof *ep)
+        return false;
+      dir->pos += sizeof *ep;
+      if (ep->in_use && !is_dot (ep->name))
+        return true;
+    }
+}
+
+/* Returns true if the directory stored in INODE contains no
+   entries other than "." and "..".  INODE's directory lock must
+   be held. */
+static bool
+is_empty (struct inode *inode)
+{
+  struct dir dir;
+  struct dx_header h;
   struct dir_entry e;
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
+  dir.inode = inode;
+  dir.pos = 0;
+  return !read_next (&dir, dx_read_header (&dir, &h), &e);
+}
+
+/* Reads DIR's hashed index header into *H.
+   Returns true if DIR is hashed, false if it is linear. */
+static bool
+dx_read_header (const struct dir *dir, struct dx_header *h)
+{
+  if (inode_read_at (dir->inode, h, sizeof *h, 0) != sizeof *h)
+    h->magic = 0;
+  return h->magic == DX_MAGIC;
+}
+
+/* Returns the offset of bucket number IDX in a hashed directory. */
+static inline off_t
+dx_bucket_ofs (size_t idx)
+{
+  return DX_BUCKET_OFS + (off_t) idx * BLOCK_SECTOR_SIZE;
+}
+
+/* Returns the offset of bucket table slot number SLOT. */
+static inline off_t
+dx_slot_ofs (size_t slot)
+{
+  return DX_TABLE_OFS + (off_t) slot * sizeof (uint16_t);
+}
+
+/* Returns the slot of the bucket table, with depth H->depth, that
+   NAME hashes to. */
+static inline size_t
+dx_slot (const struct dx_header *h, const char *name)
+{
+  return hash_string (name) & ((1u << h->depth) - 1);
+}
+
+/* Returns the offset of the first directory entry in a hashed
+   directory that is at or after OFS, skipping the header, the
+   bucket table and bucket headers. */
+static off_t
+dx_entry_ofs (off_t ofs)
+{
+  const off_t first = offsetof (struct dx_bucket, entries);
+  const off_t last = first + DX_BUCKET_ENTRIES * sizeof (struct dir_entry);
+  off_t bucket, rel;
+
+  if (ofs < DX_BUCKET_OFS)
+    return DX_BUCKET_OFS + first;
+
+  bucket = ROUND_DOWN (ofs - DX_BUCKET_OFS, BLOCK_SECTOR_SIZE);
+  rel = ofs - DX_BUCKET_OFS - bucket;
+  if (rel < first)
+    rel = first;
+  else if (rel >= last)
     {
-      dir->pos += sizeof e;
-      if (e.in_use)
+      bucket += BLOCK_SECTOR_SIZE;
+      rel = first;
+    }
+  return DX_BUCKET_OFS + bucket + rel;
+}
+
+/* Reads into *BUCKET the bucket that NAME hashes to in hashed
+   directory DIR, whose header is H, and stores its number into
+   *IDXP.  Returns true if successful, false on failure. */
+static bool
+dx_read_bucket (const struct dir *dir, const struct dx_header *h,
+                const char *name, struct dx_bucket *bucket, size_t *idxp)
+{
+  uint16_t idx;
+
+  if (inode_read_at (dir->inode, &idx, sizeof idx,
+                     dx_slot_ofs (dx_slot (h, name))) != sizeof idx
+      || idx >= h->bucket_cnt
+      || inode_read_at (dir->inode, bucket, sizeof *bucket,
+                        dx_bucket_ofs (idx)) != sizeof *bucket)
+    return false;
+  *idxp = idx;
+  return true;
+}
+
+/* As lookup(), for hashed directory DIR whose header is H. */
+static bool
+dx_lookup (const struct dir *dir, const struct dx_header *h,
+           const char *name, struct dir_entry *ep, off_t *ofsp)
+{
+  struct dx_bucket *bucket;
+  bool found = false;
+  size_t idx, i;
+
+  bucket = malloc (sizeof *bucket);
+  if (bucket == NULL || !dx_read_bucket (dir, h, name, bucket, &idx))
+    goto done;
+
+  for (i = 0; i < DX_BUCKET_ENTRIES; i++)
+    {
+      struct dir_entry *e = &bucket->entries[i];
+      if (e->in_use && !strcmp (name, e->name))
         {
-          strlcpy (name, e.name, NAME_MAX + 1);
-          return true;
-        } 
+          if (ep != NULL)
+            *ep = *e;
+          if (ofsp != NULL)
+            *ofsp = (dx_bucket_ofs (idx)
+                     + offsetof (struct dx_bucket, entries[i]));
+          found = true;
+          break;
+        }
     }
-  return false;
+
+ done:
+  free (bucket);
+  return found;
+}
+
+/* Splits bucket number IDX, whose contents are in OLD, of hashed
+   directory DIR with header H, doubling the bucket table first if
+   necessary.  Returns true if successful, false if the table is
+   already as large as it may grow or a disk or memory error
+   occurs. */
+static bool
+dx_split (struct dir *dir, struct dx_header *h, size_t idx,
+          struct dx_bucket *old)
+{
+  struct dx_bucket *new = NULL;
+  uint16_t *table = NULL;
+  size_t slot_cnt, new_idx, i, j;
+  unsigned bit;
+  bool success = false;
+
+  if (old->depth == h->depth && h->depth == DX_MAX_DEPTH)
+    return false;
+
+  new = calloc (1, sizeof *new);
+  table = malloc (sizeof *table << DX_MAX_DEPTH);
+  if (new == NULL || table == NULL)
+    goto done;
+
+  /* Read the table, doubling it if every one of its bits is
+     already needed to tell this bucket apart from its buddy. */
+  slot_cnt = (size_t) 1 << h->depth;
+  if (inode_read_at (dir->inode, table, slot_cnt * sizeof *table,
+                     DX_TABLE_OFS) != (off_t) (slot_cnt * sizeof *table))
+    goto done;
+  if (old->depth == h->depth)
+    {
+      memcpy (table + slot_cnt, table, slot_cnt * sizeof *table);
+      slot_cnt *= 2;
+      h->depth++;
+    }
+
+  /* Move the entries whose next hash bit is set into a new
+     bucket. */
+  new_idx = h->bucket_cnt;
+  bit = 1u << old->depth;
+  old->depth++;
+  new->depth = old->depth;
+  for (i = j = 0; i < DX_BUCKET_ENTRIES; i++)
+    {
+      struct dir_entry *e = &old->entries[i];
+      if (e->in_use && (hash_string (e->name) & bit) != 0)
+        {
+          new->entries[j++] = *e;
+          e->in_use = false;
+        }
+    }
+  for (i = 0; i < slot_cnt; i++)
+    if (table[i] == idx && (i & bit) != 0)
+      table[i] = new_idx;
+
+  /* Write the new bucket first, so that running out of disk
+     space leaves the directory untouched. */
+  h->bucket_cnt++;
+  success = (inode_write_at (dir->inode, new, sizeof *new,
+                             dx_bucket_ofs (new_idx)) == sizeof *new
+             && inode_write_at (dir->inode, old, sizeof *old,
+                                dx_bucket_ofs (idx)) == sizeof *old
+             && inode_write_at (dir->inode, table, slot_cnt * sizeof *table,
+                                DX_TABLE_OFS)
+                == (off_t) (slot_cnt * sizeof *table)
+             && inode_write_at (dir->inode, h, sizeof *h, 0) == sizeof *h);
+
+ done:
+  free (table);
+  free (new);
+  return success;
+}
+
+/* Adds entry E to hashed directory DIR whose header is H, which
+   must not already contain an entry by that name.
+   Returns true if successful, false on failure. */
+static bool
+dx_add (struct dir *dir, struct dx_header *h, const struct dir_entry *e)
+{
+  struct dx_bucket *bucket;
+  bool success = false;
+  size_t idx, i;
+
+  bucket = malloc (sizeof *bucket);
+  if (bucket == NULL)
+    return false;
+
+  for (;;)
+    {
+      if (!dx_read_bucket (dir, h, e->name, bucket, &idx))
+        break;
+
+      for (i = 0; i < DX_BUCKET_ENTRIES; i++)
+        if (!bucket->entries[i].in_use)
+          break;
+      if (i < DX_BUCKET_ENTRIES)
+        {
+          off_t ofs = (dx_bucket_ofs (idx)
+                       + offsetof (struct dx_bucket, entries[i]));
+          success = inode_write_at (dir->inode, e, sizeof *e, ofs)
+                    == sizeof *e;
+          break;
+        }
+
+      /* Bucket is full.  Split it and try again. */
+      if (!dx_split (dir, h, idx, bucket))
+        break;
+    }
+
+  free (bucket);
+  return success;
+}
+
+/* Converts linear directory DIR into a hashed directory, storing
+   its new header into *H.  Returns true if successful, false on
+   failure, in which case DIR is left unchanged if possible. */
+static bool
+dx_convert (struct dir *dir, struct dx_header *h)
+{
+  struct dir_entry *entries;
+  struct dx_bucket *bucket;
+  uint16_t slot = 0;
+  size_t entry_cnt, i;
+  bool success = false;
+
+  entries = malloc (DIR_LINEAR_MAX * sizeof *entries);
+  bucket = calloc (1, sizeof *bucket);
+  if (entries == NULL || bucket == NULL)
+    goto done;
+
+  /* Save the existing entries. */
+  entry_cnt = inode_read_at (dir->inode, entries,
+                             DIR_LINEAR_MAX * sizeof *entries, 0)
+              / sizeof *entries;
+
+  /* Write a single empty bucket, then the table and header over
+     the old entries, so that failing to extend the directory
+     leaves it unchanged. */
+  h->magic = DX_MAGIC;
+  h->depth = 0;
+  h->bucket_cnt = 1;
+  if (inode_write_at (dir->inode, bucket, sizeof *bucket,
+                      dx_bucket_ofs (0)) != sizeof *bucket
+      || inode_write_at (dir->inode, &slot, sizeof slot,
+                         DX_TABLE_OFS) != sizeof slot
+      || inode_write_at (dir->inode, h, sizeof *h, 0) != sizeof *h)
+    goto done;
+
+  /* Re-add the entries through the index. */
+  success = true;
+  for (i = 0; i < entry_cnt; i++)
+    if (entries[i].in_use && !dx_add (dir, h, &entries[i]))
+      success = false;
+
+ done:
+  free (bucket);
+  free (entries);
+  return success;
 }
@@ -88,9 +88,8 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at the file's current position.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk is full.
+   Writing past end of file grows the file.
    Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
@@ -103,9 +102,8 @@ file_write (struct file *file, const void *buffer, off_t size)
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk is full.
+   Writing past end of file grows the file.
    The file's current position is unaffected. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
@@ -114,6 +112,51 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads from FILE into the IOVCNT segments in IOV, in order,
+   starting at the file's current position.  Each segment is read
+   with one inode_read_at(), which reads the whole sectors in it
+   a contiguous run at a time.  Returns the number of bytes
+   actually read, which may be less than the total size of the
+   segments if end of file is reached.  Advances FILE's position
+   by the number of bytes read. */
+off_t
+file_readv (struct file *file, const struct iovec *iov, int iovcnt)
+{
+  off_t bytes_read = 0;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      off_t n = file_read (file, iov[i].iov_base, iov[i].iov_len);
+      bytes_read += n;
+      if (n < (off_t) iov[i].iov_len)
+        break;
+    }
+  return bytes_read;
+}
+
+/* Writes the IOVCNT segments in IOV, in order, into FILE,
+   starting at the file's current position.  Returns the number
+   of bytes actually written, which may be less than the total
+   size of the segments if the disk is full.  Writing past end
+   of file grows the file.  Advances FILE's position by the
+   number of bytes written. */
+off_t
+file_writev (struct file *file, const struct iovec *iov, int iovcnt)
+{
+  off_t bytes_written = 0;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      off_t n = file_write (file, iov[i].iov_base, iov[i].iov_len);
+      bytes_written += n;
+      if (n < (off_t) iov[i].iov_len)
+        break;
+    }
+  return bytes_written;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -3,9 +3,17 @@
 
 #include "filesys/off_t.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 struct inode;
 
+/* One segment of a vectored read or write. */
+struct iovec
+  {
+    void *iov_base;             /* Start of segment. */
+    size_t iov_len;             /* Number of bytes in segment. */
+  };
+
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
 struct file *file_reopen (struct file *);
@@ -17,6 +25,8 @@ off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
+off_t file_readv (struct file *, const struct iovec *, int iovcnt);
+off_t file_writev (struct file *, const struct iovec *, int iovcnt);
 
 /* Preventing writes. */
 void file_deny_write (struct file *);
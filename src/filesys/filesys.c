@@ -3,14 +3,23 @@
 #include <stdio.h>
 #include <string.h>
 #include "filesys/file.h"
+#include "filesys/dcache.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/journal.h"
+#include "threads/thread.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* The root directory's inode, kept open so that every absolute
+   path walk finds it in memory. */
+static struct inode *root_inode;
+
 static void do_format (void);
+static bool create (const char *name, off_t initial_size, bool is_dir);
+static struct dir *resolve (const char *name, char part[NAME_MAX + 1]);
 
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
@@ -22,12 +31,17 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  dcache_init ();
   free_map_init ();
+  journal_init ();
 
   if (format) 
     do_format ();
+  else
+    journal_recover ();
 
   free_map_open ();
+  root_inode = inode_open (ROOT_DIR_SECTOR);
 }
 
 /* Shuts down the file system module, writing any unwritten data
@@ -35,6 +49,9 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+  inode_flush_all ();
+  inode_close (root_inode);
+  journal_sync ();
   free_map_close ();
 }
 
@@ -45,17 +62,17 @@ filesys_done (void)
 bool
 filesys_create (const char *name, off_t initial_size) 
 {
-  block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
-  if (!success && inode_sector != 0) 
-    free_map_release (inode_sector, 1);
-  dir_close (dir);
+  return create (name, initial_size, false);
+}
 
-  return success;
+/* Creates an empty directory named NAME.
+   Returns true if successful, false otherwise.
+   Fails if a file named NAME already exists,
+   or if internal memory allocation fails. */
+bool
+filesys_mkdir (const char *name)
+{
+  return create (name, 0, true);
 }
 
 /* Opens the file with the given NAME.
@@ -66,11 +83,12 @@ filesys_create (const char *name, off_t initial_size)
 struct file *
 filesys_open (const char *name)
 {
-  struct dir *dir = dir_open_root ();
+  char part[NAME_MAX + 1];
+  struct dir *dir = resolve (name, part);
   struct inode *inode = NULL;
 
   if (dir != NULL)
-    dir_lookup (dir, name, &inode);
+    dir_lookup (dir, part, &inode);
   dir_close (dir);
 
   return file_open (inode);
@@ -78,26 +96,173 @@ filesys_open (const char *name)
 
 /* Deletes the file named NAME.
    Returns true if successful, false on failure.
-   Fails if no file named NAME exists,
-   or if an internal memory allocation fails. */
+   Fails if no file named NAME exists, if NAME is a directory
+   that is not empty, or if an internal memory allocation
+   fails. */
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  char part[NAME_MAX + 1];
+  struct dir *dir;
+  bool success;
+
+  journal_begin ();
+  dir = resolve (name, part);
+  success = dir != NULL && dir_remove (dir, part);
   dir_close (dir); 
+  journal_end ();
+
+  return success;
+}
+
+/* Makes the directory named NAME the running thread's current
+   directory, against which relative names are resolved.
+   Returns true if successful, false on failure. */
+bool
+filesys_chdir (const char *name)
+{
+  struct thread *t = thread_current ();
+  char part[NAME_MAX + 1];
+  struct dir *dir = resolve (name, part);
+  struct inode *inode = NULL;
+
+  if (dir != NULL)
+    dir_lookup (dir, part, &inode);
+  dir_close (dir);
+
+  dir = dir_open (inode);
+  if (dir == NULL)
+    return false;
+  dir_close (t->cwd);
+  t->cwd = dir;
+  return true;
+}
+
+/* Creates a file or, if IS_DIR, a directory named NAME, with the
+   given INITIAL_SIZE.  The new inode is placed near its
+   directory's. */
+static bool
+create (const char *name, off_t initial_size, bool is_dir)
+{
+  char part[NAME_MAX + 1];
+  block_sector_t inode_sector = 0;
+  struct dir *dir;
+  block_sector_t parent;
+  bool success;
+
+  journal_begin ();
+  dir = resolve (name, part);
+  parent = dir != NULL ? inode_get_inumber (dir_get_inode (dir)) : 0;
+  success = (dir != NULL
+             && free_map_allocate_run (1, parent, &inode_sector) == 1
+             && (is_dir
+                 ? dir_create (inode_sector, parent, 16)
+                 : inode_create (inode_sector, initial_size, false))
+             && dir_add (dir, part, inode_sector));
+  if (!success && inode_sector != 0) 
+    free_map_release (inode_sector, 1);
+  dir_close (dir);
+  journal_end ();
 
   return success;
 }
 
+/* Extracts a file name part from *SRCP into PART, and updates
+   *SRCP so that the next call will return the next file name
+   part.  Returns 1 if successful, 0 at end of string, -1 for a
+   too-long file name part. */
+static int
+get_next_part (char part[NAME_MAX + 1], const char **srcp)
+{
+  const char *src = *srcp;
+  char *dst = part;
+
+  /* Skip leading slashes.  If it's all slashes, we're done. */
+  while (*src == '/')
+    src++;
+  if (*src == '\0')
+    return 0;
+
+  /* Copy up to NAME_MAX character from SRC to DST.  Add null
+     terminator. */
+  while (*src != '/' && *src != '\0') 
+    {
+      if (dst < part + NAME_MAX)
+        *dst++ = *src;
+      else
+        return -1;
+      src++; 
+    }
+  *dst = '\0';
+
+  /* Advance source pointer. */
+  *srcp = src;
+  return 1;
+}
+
+/* Walks NAME, which is absolute if it begins with "/" and
+   otherwise relative to the running thread's current directory,
+   up to its last component.  Returns the directory that should
+   contain that component, which the caller must close, and
+   stores the component into PART.  A NAME that consists only of
+   slashes refers to the root directory, as "." within it.
+   Returns a null pointer if NAME is empty, any component is too
+   long, or any component but the last is not a directory. */
+static struct dir *
+resolve (const char *name, char part[NAME_MAX + 1])
+{
+  struct dir *cwd = thread_current ()->cwd;
+  struct dir *dir;
+  char next[NAME_MAX + 1];
+  int result;
+
+  if (*name == '\0')
+    return NULL;
+  dir = (*name == '/' || cwd == NULL
+         ? dir_open_root () : dir_reopen (cwd));
+  if (dir == NULL)
+    return NULL;
+
+  result = get_next_part (part, &name);
+  if (result == 0)
+    {
+      strlcpy (part, ".", NAME_MAX + 1);
+      return dir;
+    }
+  while (result > 0)
+    {
+      struct inode *inode;
+
+      result = get_next_part (next, &name);
+      if (result == 0)
+        return dir;
+      else if (result < 0)
+        break;
+
+      /* Descend into PART. */
+      dir_lookup (dir, part, &inode);
+      dir_close (dir);
+      dir = dir_open (inode);
+      if (dir == NULL)
+        return NULL;
+      strlcpy (part, next, NAME_MAX + 1);
+    }
+  dir_close (dir);
+  return NULL;
+}
+
 /* Formats the file system. */
 static void
 do_format (void)
 {
   printf ("Formatting file system...");
+  journal_create ();
+  journal_begin ();
   free_map_create ();
-  if (!dir_create (ROOT_DIR_SECTOR, 16))
+  if (!dir_create (ROOT_DIR_SECTOR, ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
+  journal_end ();
+  journal_sync ();
   free_map_close ();
   printf ("done.\n");
 }
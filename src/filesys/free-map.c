@@ -1,52 +1,370 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static struct lock free_map_lock;    /* Protects all of the below. */
+
+/* Changes to the free map are written back lazily, a sector of
+   the free map file at a time, by free_map_flush(). */
+static struct bitmap *dirty_map;     /* Free map file sectors to write. */
+static unsigned long long write_cnt; /* Free map file sectors written. */
+
+/* Number of sectors whose bits share a free map file sector. */
+#define BITS_PER_SECTOR (BLOCK_SECTOR_SIZE * 8)
+
+/* The disk is divided into groups of GROUP_SIZE sectors, and the
+   number of free sectors in each is kept up to date, so that
+   searches can skip over full groups without looking at their
+   bits. */
+#define GROUP_SIZE 512
+static uint16_t *group_free;         /* Free sectors in each group. */
+static size_t free_cnt;              /* Free sectors on the disk. */
+
+/* Where the next search without a hint begins: just past the
+   last allocation. */
+static size_t next_fit;
+
+/* Sectors released by operations whose transaction has not yet
+   been committed.  They may not be reused until it has, in case
+   the operation is lost in a crash, so free_map_release() only
+   records them here and free_map_flush() actually frees them.
+   If there is no memory for a `struct release', the sectors are
+   marked in overflow_map instead, which is allocated up front so
+   that recording a release can never fail. */
+struct release
+  {
+    struct release *next;            /* Next in list. */
+    block_sector_t sector;           /* First sector. */
+    size_t cnt;                      /* Number of sectors. */
+  };
+static struct release *releases;     /* Pending releases. */
+static size_t release_cnt;           /* Sectors in pending releases. */
+static struct bitmap *overflow_map;  /* Pending releases not in list. */
+static bool overflow;                /* Any bits set in overflow_map? */
+
+static void count_free (void);
+static size_t find_run (size_t start, size_t cnt);
+static void set_range (size_t start, size_t cnt, bool used);
+static void mark_dirty (block_sector_t, size_t);
 
 /* Initializes the free map. */
 void
 free_map_init (void) 
 {
+  lock_init (&free_map_lock);
   free_map = bitmap_create (block_size (fs_device));
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SIZE, true);
+
+  dirty_map = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+                                           BLOCK_SECTOR_SIZE));
+  group_free = malloc (DIV_ROUND_UP (bitmap_size (free_map), GROUP_SIZE)
+                       * sizeof *group_free);
+  overflow_map = bitmap_create (bitmap_size (free_map));
+  if (dirty_map == NULL || group_free == NULL || overflow_map == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
+  count_free ();
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
    the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  size_t sector;
+
+  ASSERT (cnt > 0);
+
+  lock_acquire (&free_map_lock);
+  sector = cnt <= free_cnt ? find_run (next_fit, cnt) : BITMAP_ERROR;
+  if (sector != BITMAP_ERROR)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      set_range (sector, cnt, true);
+      *sectorp = sector;
     }
-  if (sector != BITMAP_ERROR)
-    *sectorp = sector;
+  lock_release (&free_map_lock);
   return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Allocates up to CNT consecutive sectors from the free map and
+   stores the first into *SECTORP.  If sector HINT is free, the
+   run begins there, so that a file can grow its last extent in
+   place; otherwise it is the first run found at or after HINT,
+   which keeps related data close together.  A HINT of 0 means
+   no preference.
+   Returns the number of sectors allocated.  This is less than CNT
+   only if the run at HINT is shorter or no CNT consecutive free
+   sectors exist, and 0 if the disk is full. */
+size_t
+free_map_allocate_run (size_t cnt, block_sector_t hint,
+                       block_sector_t *sectorp)
+{
+  size_t size = bitmap_size (free_map);
+  size_t sector = BITMAP_ERROR;
+
+  ASSERT (cnt > 0);
+
+  lock_acquire (&free_map_lock);
+  if (cnt > free_cnt)
+    cnt = free_cnt;
+
+  /* With no hint, carry on from the last allocation.  Otherwise,
+     continue from HINT if that sector is free. */
+  if (hint == 0 || hint >= size)
+    hint = next_fit;
+  else if (!bitmap_test (free_map, hint))
+    {
+      size_t n;
+
+      for (n = 1; n < cnt && hint + n < size; n++)
+        if (bitmap_test (free_map, hint + n))
+          break;
+      sector = hint;
+      cnt = n;
+    }
+
+  /* Otherwise find the first run of CNT sectors after HINT,
+     settling for shorter runs if there is none. */
+  for (; sector == BITMAP_ERROR && cnt > 0; cnt /= 2)
+    {
+      sector = find_run (hint, cnt);
+      if (sector != BITMAP_ERROR)
+        break;
+    }
+  if (sector != BITMAP_ERROR)
+    {
+      set_range (sector, cnt, true);
+      *sectorp = sector;
+    }
+  else
+    cnt = 0;
+  lock_release (&free_map_lock);
+  return cnt;
+}
+
+/* Makes CNT sectors starting at SECTOR available for use, once
+   the running journal transaction commits. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  struct release *r = malloc (sizeof *r);
+
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  if (r != NULL)
+    {
+      r->sector = sector;
+      r->cnt = cnt;
+      r->next = releases;
+      releases = r;
+    }
+  else
+    {
+      bitmap_set_multiple (overflow_map, sector, cnt, true);
+      overflow = true;
+    }
+  release_cnt += cnt;
+  lock_release (&free_map_lock);
+}
+
+/* Returns true if so many sectors are waiting to be released
+   that the running journal transaction should be committed to
+   free them. */
+bool
+free_map_needs_flush (void)
+{
+  /* Called with the journal lock held, so this must not take
+     free_map_lock.  A stale answer does no harm. */
+  return release_cnt > 0 && release_cnt >= free_cnt / 4;
+}
+
+/* Frees the sectors whose release was pending, then writes the
+   sectors of the free map file that have changed since they were
+   last written back to disk.  Called only by the journal, as the
+   running transaction commits, so that the writes join it.
+   Returns true if successful, false if any could not be
+   written; those stay dirty. */
+bool
+free_map_flush (void)
+{
+  size_t i = 0;
+  bool success = true;
+
+  lock_acquire (&free_map_lock);
+  while (releases != NULL)
+    {
+      struct release *r = releases;
+      releases = r->next;
+      set_range (r->sector, r->cnt, false);
+      free (r);
+    }
+  if (overflow)
+    {
+      size_t size = bitmap_size (overflow_map);
+      size_t start = 0;
+
+      while ((start = bitmap_scan (overflow_map, start, 1, true))
+             != BITMAP_ERROR)
+        {
+          size_t end = start + 1;
+          while (end < size && bitmap_test (overflow_map, end))
+            end++;
+          bitmap_set_multiple (overflow_map, start, end - start, false);
+          set_range (start, end - start, false);
+          start = end;
+        }
+      overflow = false;
+    }
+  release_cnt = 0;
+  if (free_map_file == NULL)
+    {
+      lock_release (&free_map_lock);
+      return true;
+    }
+  while ((i = bitmap_scan (dirty_map, i, 1, true)) != BITMAP_ERROR)
+    {
+      if (bitmap_write_part (free_map, free_map_file,
+                             i * BLOCK_SECTOR_SIZE, BLOCK_SECTOR_SIZE))
+        {
+          bitmap_reset (dirty_map, i);
+          write_cnt++;
+        }
+      else
+        success = false;
+      i++;
+    }
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Returns the number of free map file sectors written back to
+   disk so far. */
+unsigned long long
+free_map_write_cnt (void)
+{
+  return write_cnt;
+}
+
+/* Recomputes the free sector counts from the free map. */
+static void
+count_free (void)
+{
+  size_t size = bitmap_size (free_map);
+  size_t group;
+
+  free_cnt = 0;
+  for (group = 0; group * GROUP_SIZE < size; group++)
+    {
+      size_t start = group * GROUP_SIZE;
+      size_t cnt = size - start < GROUP_SIZE ? size - start : GROUP_SIZE;
+      group_free[group] = bitmap_count (free_map, start, cnt, false);
+      free_cnt += group_free[group];
+    }
+}
+
+/* Returns the first sector at or after START, and before END,
+   that begins a run of CNT free sectors, or BITMAP_ERROR if there
+   is none.  The run may extend past END. */
+static size_t
+scan_free (size_t start, size_t end, size_t cnt)
+{
+  size_t size = bitmap_size (free_map);
+  size_t sector = start;
+
+  while (sector < end)
+    {
+      size_t group = sector / GROUP_SIZE;
+      size_t run;
+
+      if (group_free[group] == 0)
+        {
+          sector = (group + 1) * GROUP_SIZE;
+          continue;
+        }
+      if (bitmap_test (free_map, sector))
+        {
+          sector++;
+          continue;
+        }
+
+      for (run = 1; run < cnt && sector + run < size; run++)
+        if (bitmap_test (free_map, sector + run))
+          break;
+      if (run >= cnt)
+        return sector;
+      sector += run + 1;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Returns the first sector at or after START that begins a run
+   of CNT free sectors, wrapping around to the start of the disk
+   if necessary, or BITMAP_ERROR if there is none. */
+static size_t
+find_run (size_t start, size_t cnt)
+{
+  size_t sector = scan_free (start, bitmap_size (free_map), cnt);
+  if (sector == BITMAP_ERROR)
+    sector = scan_free (0, start, cnt);
+  return sector;
+}
+
+/* Marks CNT sectors starting at START as used or free, according
+   to USED, keeping the free counts and next_fit up to date and
+   scheduling the change to be written to disk. */
+static void
+set_range (size_t start, size_t cnt, bool used)
+{
+  size_t end = start + cnt;
+  size_t sector;
+
+  bitmap_set_multiple (free_map, start, cnt, used);
+  for (sector = start; sector < end; )
+    {
+      size_t group = sector / GROUP_SIZE;
+      size_t next = (group + 1) * GROUP_SIZE < end
+                    ? (group + 1) * GROUP_SIZE : end;
+
+      if (used)
+        group_free[group] -= next - sector;
+      else
+        group_free[group] += next - sector;
+      sector = next;
+    }
+  if (used)
+    {
+      free_cnt -= cnt;
+      next_fit = end < bitmap_size (free_map) ? end : 0;
+    }
+  else
+    free_cnt += cnt;
+  mark_dirty (start, cnt);
+}
+
+/* Marks the free map file sectors that hold the bits for CNT
+   sectors starting at SECTOR as needing to be written. */
+static void
+mark_dirty (block_sector_t sector, size_t cnt)
+{
+  size_t first = sector / BITS_PER_SECTOR;
+  size_t last = (sector + cnt - 1) / BITS_PER_SECTOR;
+
+  ASSERT (cnt > 0);
+  bitmap_set_multiple (dirty_map, first, last - first + 1, true);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -56,15 +374,19 @@ free_map_open (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  inode_set_metadata (file_get_inode (free_map_file));
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  count_free ();
 }
 
-/* Writes the free map to disk and closes the free map file. */
+/* Closes the free map file.  Its changes must already have been
+   committed to the journal, with journal_sync(). */
 void
 free_map_close (void) 
 {
   file_close (free_map_file);
+  free_map_file = NULL;
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -73,13 +395,18 @@ void
 free_map_create (void) 
 {
   /* Create inode. */
-  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map), false))
     PANIC ("free map creation failed");
 
-  /* Write bitmap to file. */
+  /* Write bitmap to file.  This allocates every sector of the
+     file, which starts out as a hole, so that free_map_flush()
+     never needs to allocate while it holds the free map lock. */
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  inode_set_metadata (file_get_inode (free_map_file));
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
+  bitmap_set_all (dirty_map, false);
+  write_cnt += DIV_ROUND_UP (bitmap_file_size (free_map), BLOCK_SECTOR_SIZE);
 }
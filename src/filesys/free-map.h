@@ -12,6 +12,10 @@ void free_map_open (void);
 void free_map_close (void);
 
 bool free_map_allocate (size_t, block_sector_t *);
+size_t free_map_allocate_run (size_t, block_sector_t hint, block_sector_t *);
 void free_map_release (block_sector_t, size_t);
+bool free_map_flush (void);
+bool free_map_needs_flush (void);
+unsigned long long free_map_write_cnt (void);
 
 #endif /* filesys/free-map.h */
@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,6 +10,8 @@
 #include "filesys/filesys.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* List files in the root directory. */
@@ -66,21 +69,163 @@ fsutil_rm (char **argv)
     PANIC ("%s: delete failed\n", file_name);
 }
 
+/* Streaming reads from the scratch device for fsutil_extract().
+
+   A reader thread reads the archive in chunks of CHUNK_SECTORS
+   sectors, each with one device request, into a ring of
+   CHUNK_CNT buffers, while fsutil_extract() parses headers and
+   writes file data out of the buffers that are already full.
+   Reading the scratch device thus overlaps with writing the file
+   system. */
+
+/* Number of sectors per chunk, and number of chunks. */
+#define CHUNK_PAGES 8
+#define CHUNK_SECTORS (CHUNK_PAGES * PGSIZE / BLOCK_SECTOR_SIZE)
+#define CHUNK_CNT 4
+
+/* A chunk of sectors read from the scratch device. */
+struct chunk
+  {
+    uint8_t *data;              /* CHUNK_SECTORS sectors. */
+    block_sector_t cnt;         /* Number of sectors read, 0 at end. */
+  };
+
+/* A stream of sectors from the scratch device. */
+struct stream
+  {
+    struct block *src;          /* Scratch device. */
+    struct chunk chunks[CHUNK_CNT];
+
+    /* Reader thread. */
+    block_sector_t next_read;   /* Next sector to read. */
+    struct semaphore empty;     /* Up for each chunk free to read into. */
+    struct semaphore full;      /* Up for each chunk read. */
+    struct semaphore done;      /* Up when the reader thread exits. */
+    bool stop;                  /* Set to ask the reader to exit. */
+
+    /* Consumer. */
+    block_sector_t sector;      /* Next sector to consume. */
+    size_t chunk_idx;           /* Chunk being consumed. */
+    block_sector_t ofs;         /* Sectors consumed from that chunk. */
+  };
+
+static thread_func stream_reader;
+
+/* Starts streaming sectors from SRC into S, beginning at
+   SECTOR. */
+static void
+stream_open (struct stream *s, struct block *src, block_sector_t sector)
+{
+  size_t i;
+
+  s->src = src;
+  for (i = 0; i < CHUNK_CNT; i++)
+    {
+      s->chunks[i].data = palloc_get_multiple (PAL_ASSERT, CHUNK_PAGES);
+      s->chunks[i].cnt = 0;
+    }
+  s->next_read = sector;
+  sema_init (&s->empty, CHUNK_CNT);
+  sema_init (&s->full, 0);
+  sema_init (&s->done, 0);
+  s->stop = false;
+  s->sector = sector;
+
+  if (thread_create ("extract", PRI_DEFAULT, stream_reader, s) == TID_ERROR)
+    PANIC ("couldn't start reader thread");
+
+  /* Wait for the first chunk. */
+  s->chunk_idx = 0;
+  s->ofs = 0;
+  sema_down (&s->full);
+  if (s->chunks[0].cnt == 0)
+    PANIC ("ustar archive runs past end of scratch device");
+}
+
+/* Returns the next sector of S and up to MAX_CNT - 1 sectors
+   that follow it in memory, storing their number in *CNT, and
+   consumes them.  The returned data remains valid until the next
+   call. */
+static void *
+stream_next (struct stream *s, block_sector_t max_cnt, block_sector_t *cnt)
+{
+  struct chunk *c = &s->chunks[s->chunk_idx];
+  void *data;
+
+  if (s->ofs >= c->cnt)
+    {
+      /* Hand the chunk back to the reader and wait for the next
+         one. */
+      sema_up (&s->empty);
+      s->chunk_idx = (s->chunk_idx + 1) % CHUNK_CNT;
+      s->ofs = 0;
+      sema_down (&s->full);
+      c = &s->chunks[s->chunk_idx];
+      if (c->cnt == 0)
+        PANIC ("ustar archive runs past end of scratch device");
+    }
+
+  *cnt = c->cnt - s->ofs < max_cnt ? c->cnt - s->ofs : max_cnt;
+  data = c->data + s->ofs * BLOCK_SECTOR_SIZE;
+  s->ofs += *cnt;
+  s->sector += *cnt;
+  return data;
+}
+
+/* Stops streaming from S and frees its buffers.  Returns the
+   sector after the last one consumed. */
+static block_sector_t
+stream_close (struct stream *s)
+{
+  size_t i;
+
+  s->stop = true;
+  sema_up (&s->empty);
+  sema_down (&s->done);
+  for (i = 0; i < CHUNK_CNT; i++)
+    palloc_free_multiple (s->chunks[i].data, CHUNK_PAGES);
+  return s->sector;
+}
+
+/* Reader thread for stream S_.  Reads chunks into the buffers
+   that the consumer has released until it is asked to stop or
+   reaches the end of the device. */
+static void
+stream_reader (void *s_)
+{
+  struct stream *s = s_;
+  size_t i;
+
+  for (i = 0; ; i = (i + 1) % CHUNK_CNT)
+    {
+      struct chunk *c = &s->chunks[i];
+      block_sector_t left;
+
+      sema_down (&s->empty);
+      if (s->stop)
+        break;
+
+      left = block_size (s->src) - s->next_read;
+      c->cnt = left < CHUNK_SECTORS ? left : CHUNK_SECTORS;
+      block_read_multi (s->src, s->next_read, c->cnt, c->data);
+      s->next_read += c->cnt;
+      sema_up (&s->full);
+      if (c->cnt == 0)
+        break;
+    }
+  sema_up (&s->done);
+}
+
 /* Extracts a ustar-format tar archive from the scratch block
    device into the PintOS file system. */
 void
 fsutil_extract (char **argv UNUSED) 
 {
   static block_sector_t sector = 0;
+  static const uint8_t zeros[BLOCK_SECTOR_SIZE];
 
   struct block *src;
-  void *header, *data;
-
-  /* Allocate buffers. */
-  header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
-  if (header == NULL || data == NULL)
-    PANIC ("couldn't allocate buffers");
+  struct stream stream;
 
   /* Open source block device. */
   src = block_get_role (BLOCK_SCRATCH);
@@ -90,18 +235,22 @@ fsutil_extract (char **argv UNUSED)
   printf ("Extracting ustar archive from scratch device "
           "into file system...\n");
 
+  stream_open (&stream, src, sector);
   for (;;)
     {
       const char *file_name;
       const char *error;
       enum ustar_type type;
+      block_sector_t cnt;
+      void *header;
       int size;
 
       /* Read and parse ustar header. */
-      block_read (src, sector++, header);
+      header = stream_next (&stream, 1, &cnt);
       error = ustar_parse_header (header, &file_name, &type, &size);
       if (error != NULL)
-        PANIC ("bad ustar header in sector %"PRDSNu" (%s)", sector - 1, error);
+        PANIC ("bad ustar header in sector %"PRDSNu" (%s)",
+               stream.sector - 1, error);
 
       if (type == USTAR_EOF)
         {
@@ -116,20 +265,24 @@ fsutil_extract (char **argv UNUSED)
 
           printf ("Putting '%s' into the file system...\n", file_name);
 
-          /* Create destination file. */
+          /* Create destination file.  The file system creates it
+             sparse, so its initial size costs no writes. */
           if (!filesys_create (file_name, size))
             PANIC ("%s: create failed", file_name);
           dst = filesys_open (file_name);
           if (dst == NULL)
             PANIC ("%s: open failed", file_name);
 
-          /* Do copy. */
+          /* Do copy, as many sectors at a time as the stream has
+             ready. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
+              void *data = stream_next (&stream,
+                                        DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE),
+                                        &cnt);
+              int chunk_size = (size > (int) (cnt * BLOCK_SECTOR_SIZE)
+                                ? (int) (cnt * BLOCK_SECTOR_SIZE)
                                 : size);
-              block_read (src, sector++, data);
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
@@ -140,18 +293,15 @@ fsutil_extract (char **argv UNUSED)
           file_close (dst);
         }
     }
+  sector = stream_close (&stream);
 
   /* Erase the ustar header from the start of the block device,
      so that the extraction operation is idempotent.  We erase
      two blocks because two blocks of zeros are the ustar
      end-of-archive marker. */
   printf ("Erasing ustar archive...\n");
-  memset (header, 0, BLOCK_SECTOR_SIZE);
-  block_write (src, 0, header);
-  block_write (src, 1, header);
-
-  free (data);
-  free (header);
+  block_write (src, 0, zeros);
+  block_write (src, 1, zeros);
 }
 
 /* Copies file FILE_NAME from the file system to the scratch
@@ -1,79 +1,891 @@
 #include "filesys/inode.h"
-#include <list.h>
+#include <hash.h>
 #include <debug.h>
-#include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* A run of LENGTH consecutive disk sectors starting at START
+   that holds LENGTH consecutive sectors of a file, starting at
+   sector FILE_SECTOR of the file. */
+struct extent
+  {
+    uint32_t file_sector;               /* First file sector. */
+    block_sector_t start;               /* First disk sector. */
+    uint32_t length;                    /* Number of sectors. */
+  };
+
+/* Entry in an interior node of an extent tree: the subtree rooted
+   at sector CHILD holds extents starting at FILE_SECTOR or
+   later. */
+struct extent_index
+  {
+    uint32_t file_sector;               /* Lower bound of subtree. */
+    block_sector_t child;               /* Sector of child node. */
+  };
+
+/* Number of entries that fit in an inode's tree root and in any
+   other tree node. */
+#define ROOT_BYTES (BLOCK_SECTOR_SIZE - 4 * sizeof (uint32_t))
+#define ROOT_EXTENT_CNT (ROOT_BYTES / sizeof (struct extent))
+#define ROOT_INDEX_CNT (ROOT_BYTES / sizeof (struct extent_index))
+#define NODE_BYTES (BLOCK_SECTOR_SIZE - 2 * sizeof (uint32_t))
+#define NODE_EXTENT_CNT (NODE_BYTES / sizeof (struct extent))
+#define NODE_INDEX_CNT (NODE_BYTES / sizeof (struct extent_index))
+
+/* Maximum depth of an extent tree.  At this depth, even a file
+   fragmented into single sectors can cover any disk Pintos
+   supports. */
+#define TREE_MAX_DEPTH 3
+
 /* On-disk inode.
-   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.
+
+   A file's data is mapped by a B+-tree of extents, sorted by file
+   sector.  At depth 0 the extents are held directly in the inode.
+   When they no longer fit, they move into leaf sectors and the
+   inode holds an index of the leaves instead, and so on up to
+   TREE_MAX_DEPTH levels of index.
+
+   File sectors not covered by any extent are holes, which read
+   as zeros and are allocated when first written.
+
+   A file of at most INLINE_MAX bytes instead keeps its data in
+   the space of the tree root, so that it needs no sectors besides
+   the inode.  It moves out to a data sector once it grows any
+   larger. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    uint16_t depth;                     /* Depth of extent tree. */
+    uint8_t is_dir;                     /* 1 if a directory, 0 if not. */
+    uint8_t is_inline;                  /* 1 if data is in ROOT. */
+    uint32_t entry_cnt;                 /* Number of entries in root. */
+    union
+      {
+        struct extent extents[ROOT_EXTENT_CNT];         /* Depth 0. */
+        struct extent_index index[ROOT_INDEX_CNT];      /* Otherwise. */
+        uint8_t data[ROOT_BYTES];                       /* Inline. */
+      }
+    root;
   };
 
-/* Returns the number of sectors to allocate for an inode SIZE
-   bytes long. */
-static inline size_t
-bytes_to_sectors (off_t size)
-{
-  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
-}
+/* Largest file whose data is kept in its inode. */
+#define INLINE_MAX ((off_t) ROOT_BYTES)
+
+/* Extent tree node other than the root: a leaf, which holds
+   extents, or an interior node, which holds an index.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct extent_node
+  {
+    uint32_t entry_cnt;                 /* Number of entries. */
+    uint32_t unused;                    /* Not used. */
+    union
+      {
+        struct extent extents[NODE_EXTENT_CNT];         /* Leaf. */
+        struct extent_index index[NODE_INDEX_CNT];      /* Interior. */
+      }
+    e;
+  };
 
-/* In-memory inode. */
+/* Data appended to a file is held in a write buffer of up to
+   WBUF_SIZE bytes, and disk sectors are allocated for it only
+   when it is written back: when the buffer fills, when the file
+   is written somewhere that overlaps or follows it, or when the
+   file is closed.  The whole buffer is then allocated as one run,
+   so that a file built by many small appends, even interleaved
+   with appends to other files, is still laid out in long runs.
+   The inode on disk counts the buffered bytes in its length only
+   once they have been written back. */
+#define WBUF_SIZE (64 * 1024)
+
+/* In-memory inode.
+
+   RWLOCK protects the file's length and data, including DATA,
+   DIRTY, DENY_WRITE_CNT and the write buffer: reads hold it
+   shared, and anything that changes the file holds it
+   exclusively.  Shared holders can all use the leaf cache, so
+   MAP_LOCK serializes lookups in the extent tree.  DIR_LOCK is
+   not used by this file at all; it serializes operations on the
+   inode as a directory, which read and write it through the
+   usual functions. */
 struct inode 
   {
-    struct list_elem elem;              /* Element in inode list. */
+    struct hash_elem hash_elem;         /* Element in open_inodes. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
+    struct rwlock rwlock;               /* Protects data and length. */
+    struct lock map_lock;               /* Protects leaf cache. */
+    struct lock dir_lock;               /* Protects directory entries. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    bool dirty;                         /* DATA changed since written? */
+    bool metadata;                      /* Journal data writes? */
+    block_sector_t leaf_sector;         /* Sector in LEAF, or 0. */
+    struct extent_node *leaf;           /* Last leaf used, or null. */
+    uint8_t *wbuf;                      /* Write buffer, or null. */
+    off_t wbuf_ofs;                     /* File offset of WBUF[0]. */
+    off_t wbuf_end;                     /* End of buffered data, or 0. */
     struct inode_disk data;             /* Inode content. */
   };
 
-/* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
-static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
+/* A node of an inode's extent tree, in memory. */
+struct tree_node
+  {
+    block_sector_t sector;              /* Node's sector, or 0 for root. */
+    struct extent_node *buf;            /* Node's contents, or null for root. */
+    uint32_t *cnt;                      /* Number of entries. */
+    void *entries;                      /* Extents or index entries. */
+    size_t max_cnt;                     /* Capacity. */
+  };
+
+/* Path from the root of an inode's extent tree down to a leaf. */
+struct tree_path
+  {
+    block_sector_t sectors[TREE_MAX_DEPTH + 1]; /* Node at each level. */
+    size_t idx[TREE_MAX_DEPTH];         /* Index entry taken at each level. */
+    uint32_t next_key;                  /* Lower bound of next leaf. */
+  };
+
+static void read_data (struct inode *, block_sector_t, block_sector_t cnt,
+                       void *);
+static void write_data (struct inode *, block_sector_t, block_sector_t cnt,
+                        const void *);
+
+/* Returns the number of elements in sorted ARRAY, of CNT
+   elements of SIZE bytes each that begin with a uint32_t key,
+   whose keys are less than or equal to KEY. */
+static size_t
+upper_bound (const void *array, size_t cnt, size_t size, uint32_t key)
 {
-  ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
+  const uint8_t *base = array;
+  size_t lo = 0, hi = cnt;
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (*(const uint32_t *) (base + mid * size) <= key)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+/* Reads leaf SECTOR of INODE, through INODE's one-leaf cache.
+   Returns a null pointer if memory allocation fails. */
+static struct extent_node *
+read_leaf (struct inode *inode, block_sector_t sector)
+{
+  if (inode->leaf == NULL)
+    {
+      inode->leaf = malloc (sizeof *inode->leaf);
+      if (inode->leaf == NULL)
+        return NULL;
+      inode->leaf_sector = 0;
+    }
+  if (inode->leaf_sector != sector)
+    {
+      journal_read (sector, inode->leaf);
+      inode->leaf_sector = sector;
+    }
+  return inode->leaf;
+}
+
+/* Initializes *NODE to the node at LEVEL of INODE's extent tree,
+   which is stored in SECTOR unless LEVEL is 0.  A leaf is read
+   into INODE's leaf cache, an interior node into BUF.
+   Returns false if memory allocation fails. */
+static bool
+get_node (struct inode *inode, size_t level, block_sector_t sector,
+          struct extent_node *buf, struct tree_node *node)
+{
+  bool leaf = level == inode->data.depth;
+
+  if (level == 0)
+    {
+      node->sector = 0;
+      node->buf = NULL;
+      node->cnt = &inode->data.entry_cnt;
+      node->entries = &inode->data.root;
+      node->max_cnt = leaf ? ROOT_EXTENT_CNT : ROOT_INDEX_CNT;
+      return true;
+    }
+
+  if (leaf)
+    {
+      buf = read_leaf (inode, sector);
+      if (buf == NULL)
+        return false;
+    }
+  else
+    journal_read (sector, buf);
+  node->sector = sector;
+  node->buf = buf;
+  node->cnt = &buf->entry_cnt;
+  node->entries = &buf->e;
+  node->max_cnt = leaf ? NODE_EXTENT_CNT : NODE_INDEX_CNT;
+  return true;
+}
+
+/* Writes NODE of INODE's extent tree back to disk, or just marks
+   INODE's `struct inode_disk' dirty if NODE is the root. */
+static void
+write_node (struct inode *inode, const struct tree_node *node)
+{
+  if (node->buf != NULL)
+    journal_write (node->sector, node->buf);
+  else
+    inode->dirty = true;
+}
+
+/* Walks INODE's extent tree from the root down to the leaf that
+   should contain file sector FILE_SECTOR, recording the way taken
+   in *PATH, and initializes *LEAF to that leaf.
+   Returns false if memory allocation fails. */
+static bool
+find_leaf (struct inode *inode, uint32_t file_sector,
+           struct tree_path *path, struct tree_node *leaf)
+{
+  struct extent_node *buf = NULL;
+  size_t level;
+  bool success = true;
+
+  if (inode->data.depth > 1)
+    {
+      buf = malloc (sizeof *buf);
+      if (buf == NULL)
+        return false;
+    }
+
+  path->sectors[0] = 0;
+  path->next_key = UINT32_MAX;
+  for (level = 0; ; level++)
+    {
+      struct extent_index *index;
+      size_t i;
+
+      if (!get_node (inode, level, path->sectors[level], buf, leaf))
+        {
+          success = false;
+          break;
+        }
+      if (level == inode->data.depth)
+        break;
+
+      index = leaf->entries;
+      i = upper_bound (index, *leaf->cnt, sizeof *index, file_sector);
+      if (i > 0)
+        i--;
+      if (i + 1 < *leaf->cnt)
+        path->next_key = index[i + 1].file_sector;
+      path->idx[level] = i;
+      path->sectors[level + 1] = index[i].child;
+    }
+  free (buf);
+  return success;
+}
+
+/* Stores into *SECTORP the disk sector holding file sector
+   FILE_SECTOR of INODE, or 0 if FILE_SECTOR is in a hole.
+   If RUN is nonnull, stores into *RUN the number of sectors from
+   FILE_SECTOR to the end of the extent that contains it, or, for
+   a hole, a number of sectors that are all in the hole.
+   For a hole, also stores into *HINT, if HINT is nonnull, the
+   disk sector that would continue the extent before the hole, or
+   INODE's own sector if there is none, to keep its data close.
+   Returns false, storing nothing, if memory allocation fails. */
+static bool
+lookup_sector (struct inode *inode, uint32_t file_sector,
+               block_sector_t *sectorp, uint32_t *run, block_sector_t *hint)
+{
+  struct tree_path path;
+  struct tree_node leaf;
+  struct extent prev = {0, 0, 0};
+  block_sector_t sector = 0;
+  uint32_t hole_end = UINT32_MAX;
+
+  lock_acquire (&inode->map_lock);
+  if (inode->data.entry_cnt > 0)
+    {
+      const struct extent *extents;
+      size_t i;
+
+      if (!find_leaf (inode, file_sector, &path, &leaf))
+        {
+          lock_release (&inode->map_lock);
+          return false;
+        }
+      extents = leaf.entries;
+      i = upper_bound (extents, *leaf.cnt, sizeof *extents, file_sector);
+      if (i > 0)
+        prev = extents[i - 1];
+
+      /* In a hole, find where the next extent begins. */
+      hole_end = i < *leaf.cnt ? extents[i].file_sector : path.next_key;
+    }
+  lock_release (&inode->map_lock);
+
+  if (prev.length > 0 && file_sector - prev.file_sector < prev.length)
+    {
+      sector = prev.start + (file_sector - prev.file_sector);
+      if (run != NULL)
+        *run = prev.length - (file_sector - prev.file_sector);
+    }
+  else
+    {
+      if (run != NULL)
+        *run = hole_end - file_sector;
+      if (hint != NULL)
+        *hint = (prev.length > 0
+                 ? prev.start + (file_sector - prev.file_sector)
+                 : inode->sector);
+    }
+  *sectorp = sector;
+  return true;
+}
+
+/* Moves the entries in the root of INODE's extent tree into a new
+   node, which becomes the root's only child, so that the tree
+   grows one level deeper.
+   Returns false if the tree is already as deep as it may be or a
+   sector or memory cannot be allocated. */
+static bool
+deepen_tree (struct inode *inode)
+{
+  struct inode_disk *d = &inode->data;
+  struct extent_node *node;
+  block_sector_t sector;
+  size_t size = d->depth == 0 ? sizeof (struct extent)
+                              : sizeof (struct extent_index);
+
+  ASSERT (d->entry_cnt > 0);
+
+  if (d->depth >= TREE_MAX_DEPTH)
+    return false;
+  node = calloc (1, sizeof *node);
+  if (node == NULL)
+    return false;
+  if (!free_map_allocate (1, &sector))
+    {
+      free (node);
+      return false;
+    }
+
+  node->entry_cnt = d->entry_cnt;
+  memcpy (&node->e, &d->root, d->entry_cnt * size);
+  journal_write (sector, node);
+
+  d->root.index[0].file_sector = *(uint32_t *) &node->e;
+  d->root.index[0].child = sector;
+  d->entry_cnt = 1;
+  d->depth++;
+  inode->dirty = true;
+
+  /* A new leaf takes the place of the cached one. */
+  if (d->depth == 1)
+    {
+      free (inode->leaf);
+      inode->leaf = node;
+      inode->leaf_sector = sector;
+    }
+  else
+    free (node);
+  return true;
+}
+
+/* Makes room in the full node at LEVEL along PATH in INODE's
+   extent tree, by splitting it in two or, for the root, by
+   deepening the tree.  If the node's parent is full too, makes
+   room there instead, so the caller should walk the tree again
+   and retry.
+   Returns false if the tree cannot grow or a sector or memory
+   cannot be allocated. */
+static bool
+make_room (struct inode *inode, const struct tree_path *path, size_t level)
+{
+  struct extent_node *parent_buf, *node_buf, *upper;
+  struct tree_node parent, node;
+  struct extent_index *idx;
+  block_sector_t sector;
+  size_t size, half;
+  bool success = false;
+
+  if (level == 0)
+    return deepen_tree (inode);
+
+  parent_buf = malloc (sizeof *parent_buf);
+  node_buf = malloc (sizeof *node_buf);
+  upper = calloc (1, sizeof *upper);
+  if (parent_buf == NULL || node_buf == NULL || upper == NULL
+      || !get_node (inode, level - 1, path->sectors[level - 1],
+                    parent_buf, &parent))
+    goto done;
+  if (*parent.cnt >= parent.max_cnt)
+    {
+      success = make_room (inode, path, level - 1);
+      goto done;
+    }
+  if (!get_node (inode, level, path->sectors[level], node_buf, &node)
+      || !free_map_allocate (1, &sector))
+    goto done;
+
+  /* Write the upper half to the new node, then the lower half
+     back in place. */
+  size = level == inode->data.depth ? sizeof (struct extent)
+                                    : sizeof (struct extent_index);
+  half = *node.cnt / 2;
+  upper->entry_cnt = *node.cnt - half;
+  memcpy (&upper->e, (uint8_t *) node.entries + half * size,
+          upper->entry_cnt * size);
+  journal_write (sector, upper);
+  *node.cnt = half;
+  write_node (inode, &node);
+
+  /* Index the new node in the parent. */
+  idx = (struct extent_index *) parent.entries + path->idx[level - 1] + 1;
+  memmove (idx + 1, idx, ((struct extent_index *) parent.entries
+                          + *parent.cnt - idx) * sizeof *idx);
+  idx->file_sector = *(uint32_t *) &upper->e;
+  idx->child = sector;
+  (*parent.cnt)++;
+  write_node (inode, &parent);
+  success = true;
+
+ done:
+  free (parent_buf);
+  free (node_buf);
+  free (upper);
+  return success;
+}
+
+/* Adds extent NEW, which must not overlap any of INODE's existing
+   extents, to INODE's extent tree, merging it with its neighbors
+   where they are contiguous both in the file and on disk.
+   Returns false if the tree is full or a sector for it cannot be
+   allocated.
+
+   Index entries are only lower bounds on the file sectors in
+   their subtrees, so they never need updating here: NEW is
+   always added to a subtree whose bound it satisfies. */
+static bool
+insert_extent (struct inode *inode, const struct extent *new)
+{
+  for (;;)
+    {
+      struct tree_path path;
+      struct tree_node leaf;
+      struct extent *extents, *prev, *next;
+      size_t i;
+
+      if (!find_leaf (inode, new->file_sector, &path, &leaf))
+        return false;
+      extents = leaf.entries;
+      i = upper_bound (extents, *leaf.cnt, sizeof *extents, new->file_sector);
+      prev = i > 0 ? &extents[i - 1] : NULL;
+      next = i < *leaf.cnt ? &extents[i] : NULL;
+
+      if (prev != NULL
+          && prev->file_sector + prev->length == new->file_sector
+          && prev->start + prev->length == new->start)
+        {
+          /* Extend the previous extent, and absorb the next one if
+             the new extent closes the gap between them. */
+          prev->length += new->length;
+          if (next != NULL
+              && prev->file_sector + prev->length == next->file_sector
+              && prev->start + prev->length == next->start)
+            {
+              prev->length += next->length;
+              memmove (next, next + 1, (*leaf.cnt - i - 1) * sizeof *next);
+              (*leaf.cnt)--;
+            }
+        }
+      else if (next != NULL
+               && new->file_sector + new->length == next->file_sector
+               && new->start + new->length == next->start)
+        {
+          /* Extend the next extent backward. */
+          next->file_sector = new->file_sector;
+          next->start = new->start;
+          next->length += new->length;
+        }
+      else if (*leaf.cnt < leaf.max_cnt)
+        {
+          memmove (extents + i + 1, extents + i,
+                   (*leaf.cnt - i) * sizeof *extents);
+          extents[i] = *new;
+          (*leaf.cnt)++;
+        }
+      else
+        {
+          /* No room.  Make some and try again. */
+          if (!make_room (inode, &path, inode->data.depth))
+            return false;
+          continue;
+        }
+
+      write_node (inode, &leaf);
+      return true;
+    }
+}
+
+/* Allocates disk sectors for every hole in file sectors FIRST
+   through LAST, inclusive, of INODE, in as few runs as possible.
+   Each run is placed right after the data that precedes it in
+   the file, if that space is free, or else as soon after it on
+   disk as possible.  Runs at the start of the file go near the
+   inode.
+   Returns false if the disk or the extent tree is full or memory
+   allocation fails. */
+static bool
+allocate_range (struct inode *inode, uint32_t first, uint32_t last)
+{
+  uint32_t file_sector = first;
+
+  while (file_sector <= last)
+    {
+      struct extent new;
+      block_sector_t sector, hint;
+      uint32_t run;
+
+      if (!lookup_sector (inode, file_sector, &sector, &run, &hint))
+        return false;
+      if (sector == 0)
+        {
+          if (run > last - file_sector + 1)
+            run = last - file_sector + 1;
+          new.file_sector = file_sector;
+          new.length = free_map_allocate_run (run, hint, &new.start);
+          if (new.length == 0)
+            return false;
+          if (!insert_extent (inode, &new))
+            {
+              free_map_release (new.start, new.length);
+              return false;
+            }
+          run = new.length;
+        }
+      if (run > last - file_sector)
+        break;
+      file_sector += run;
+    }
+  return true;
+}
+
+/* Writes INODE's `struct inode_disk' back to disk if it has
+   changed. */
+static void
+flush_inode (struct inode *inode)
+{
+  if (inode->dirty)
+    {
+      journal_write (inode->sector, &inode->data);
+      inode->dirty = false;
+    }
+}
+
+/* Moves INODE's inline data into a data sector of its own, so
+   that the file can grow past INLINE_MAX bytes.  INODE must be
+   locked for writing.
+   Returns false if memory or a sector cannot be allocated, in
+   which case INODE is unchanged. */
+static bool
+uninline (struct inode *inode)
+{
+  struct inode_disk *d = &inode->data;
+  uint8_t *data;
+  bool success = true;
+
+  data = calloc (1, BLOCK_SECTOR_SIZE);
+  if (data == NULL)
+    return false;
+  memcpy (data, d->root.data, INLINE_MAX);
+  memset (&d->root, 0, sizeof d->root);
+  d->is_inline = false;
+
+  if (d->length > 0)
+    {
+      block_sector_t sector;
+
+      if (allocate_range (inode, 0, 0)
+          && lookup_sector (inode, 0, &sector, NULL, NULL))
+        write_data (inode, sector, 1, data);
+      else
+        {
+          memcpy (d->root.data, data, INLINE_MAX);
+          d->is_inline = true;
+          success = false;
+        }
+    }
+  inode->dirty = true;
+  free (data);
+  return success;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+   allocating disk sectors for them as necessary, and extends
+   INODE if the write goes past its end.  INODE must be locked
+   for writing, within a journal transaction.
+   Returns the number of bytes actually written, which may be
+   less than SIZE if the disk is full or an error occurs. */
+static off_t
+write_through (struct inode *inode, const uint8_t *buffer, off_t size,
+               off_t offset)
+{
+  off_t bytes_written = 0;
+  uint8_t *bounce = NULL;
+  uint32_t first, last;
+  block_sector_t first_sector, last_sector;
+  bool first_fresh, last_fresh;
+
+  /* Allocate the whole range at once, so that it is laid out in
+     long runs.  Remember which partially written sectors at its
+     ends are new: those start out as zeros rather than being
+     read in.  (If allocation fails partway, we write up to the
+     first unallocated sector.) */
+  first = offset / BLOCK_SECTOR_SIZE;
+  last = (offset + size - 1) / BLOCK_SECTOR_SIZE;
+  if (!lookup_sector (inode, first, &first_sector, NULL, NULL)
+      || !lookup_sector (inode, last, &last_sector, NULL, NULL))
+    return 0;
+  first_fresh = first_sector == 0;
+  last_fresh = last_sector == 0;
+  allocate_range (inode, first, last);
+
+  while (size > 0) 
+    {
+      /* Starting byte offset within sector, bytes left in sector. */
+      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+      int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
+
+      /* Number of bytes to actually write into this sector. */
+      int chunk_size = size < sector_left ? size : sector_left;
+
+      /* Sector to write, number of sectors contiguous with it on
+         disk, and whether it was just allocated. */
+      block_sector_t sector_idx;
+      uint32_t run;
+      uint32_t file_sector = offset / BLOCK_SECTOR_SIZE;
+      bool fresh = ((file_sector == first && first_fresh)
+                    || (file_sector == last && last_fresh));
+
+      /* We need a bounce buffer for a partial sector. */
+      if (chunk_size < BLOCK_SECTOR_SIZE && bounce == NULL) 
+        {
+          bounce = malloc (BLOCK_SECTOR_SIZE);
+          if (bounce == NULL)
+            break;
+        }
+
+      if (!lookup_sector (inode, file_sector, &sector_idx, &run, NULL)
+          || sector_idx == 0)
+        break;
+
+      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+        {
+          /* Write full sectors directly to disk, a contiguous run
+             at a time. */
+          if (run > (uint32_t) (size / BLOCK_SECTOR_SIZE))
+            run = size / BLOCK_SECTOR_SIZE;
+          chunk_size = run * BLOCK_SECTOR_SIZE;
+          write_data (inode, sector_idx, run, buffer + bytes_written);
+        }
+      else 
+        {
+          /* If the sector contains data before or after the chunk
+             we're writing, then we need to read in the sector
+             first.  Otherwise, or if the sector was only just
+             allocated, we start with a sector of all zeros. */
+          if (!fresh && (sector_ofs > 0 || chunk_size < sector_left))
+            read_data (inode, sector_idx, 1, bounce);
+          else
+            memset (bounce, 0, BLOCK_SECTOR_SIZE);
+          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
+          write_data (inode, sector_idx, 1, bounce);
+        }
+
+      /* Advance. */
+      size -= chunk_size;
+      offset += chunk_size;
+      bytes_written += chunk_size;
+    }
+  free (bounce);
+
+  /* Extend the file past the last byte written. */
+  if (bytes_written > 0 && offset > inode->data.length)
+    {
+      inode->data.length = offset;
+      inode->dirty = true;
+    }
+
+  return bytes_written;
+}
+
+/* Copies SIZE bytes from BUFFER into INODE's write buffer, to be
+   written at OFFSET, if they fit there: either the buffer holds
+   data that OFFSET falls within or directly follows, or it is
+   empty and OFFSET is the end of file.  INODE must be locked for
+   writing.
+   Returns true if successful, false if the data does not fit or
+   memory cannot be allocated. */
+static bool
+buffer_write (struct inode *inode, const uint8_t *buffer, off_t size,
+              off_t offset)
+{
+  if (inode->wbuf_end == 0)
+    {
+      if (offset != inode->data.length || size > WBUF_SIZE)
+        return false;
+      if (inode->wbuf == NULL)
+        {
+          inode->wbuf = malloc (WBUF_SIZE);
+          if (inode->wbuf == NULL)
+            return false;
+        }
+      inode->wbuf_ofs = offset;
+    }
+  else if (offset < inode->wbuf_ofs || offset > inode->wbuf_end
+           || offset + size > inode->wbuf_ofs + WBUF_SIZE)
+    return false;
+
+  memcpy (inode->wbuf + (offset - inode->wbuf_ofs), buffer, size);
+  if (offset + size > inode->wbuf_end)
+    inode->wbuf_end = offset + size;
+  return true;
+}
+
+/* Writes back the data in INODE's write buffer, if any, allocating
+   sectors for all of it at once, and empties the buffer.  INODE
+   must be locked for writing, within a journal transaction.  If
+   the disk fills up, data that cannot be written is lost, and the
+   file ends where the written data does. */
+static void
+flush_wbuf (struct inode *inode)
+{
+  if (inode->wbuf_end > 0)
+    {
+      write_through (inode, inode->wbuf, inode->wbuf_end - inode->wbuf_ofs,
+                     inode->wbuf_ofs);
+      barrier ();
+      inode->wbuf_end = 0;
+    }
+}
+
+/* Releases the data sectors mapped by the CNT entries in ENTRIES
+   of a node at LEVEL of INODE's extent tree, along with the nodes
+   below it.  BUF is scratch space for reading child nodes, one per
+   remaining level of the tree. */
+static void
+release_entries (struct inode *inode, const void *entries, size_t cnt,
+                 size_t level, struct extent_node *buf)
+{
+  size_t i;
+
+  if (level == inode->data.depth)
+    {
+      const struct extent *extents = entries;
+      for (i = 0; i < cnt; i++)
+        free_map_release (extents[i].start, extents[i].length);
+    }
   else
-    return -1;
+    {
+      const struct extent_index *index = entries;
+      for (i = 0; i < cnt; i++)
+        {
+          journal_read (index[i].child, buf);
+          release_entries (inode, &buf->e, buf->entry_cnt, level + 1,
+                           buf + 1);
+          free_map_release (index[i].child, 1);
+        }
+    }
+}
+
+/* Releases all of INODE's data sectors and tree nodes.  If memory
+   allocation fails, the sectors are leaked. */
+static void
+deallocate (struct inode *inode)
+{
+  struct inode_disk *d = &inode->data;
+  struct extent_node *buf = NULL;
+
+  if (d->depth > 0)
+    {
+      buf = malloc (d->depth * sizeof *buf);
+      if (buf == NULL)
+        return;
+    }
+  release_entries (inode, &d->root, d->entry_cnt, 0, buf);
+  free (buf);
+}
+
+/* Returns the number of extents mapped by the CNT entries in
+   ENTRIES of a node at LEVEL of INODE's extent tree.  BUF is
+   scratch space for reading child nodes, one per remaining level
+   of the tree. */
+static size_t
+count_extents (struct inode *inode, const void *entries, size_t cnt,
+               size_t level, struct extent_node *buf)
+{
+  const struct extent_index *index = entries;
+  size_t extent_cnt = 0;
+  size_t i;
+
+  if (level == inode->data.depth)
+    return cnt;
+  for (i = 0; i < cnt; i++)
+    {
+      journal_read (index[i].child, buf);
+      extent_cnt += count_extents (inode, &buf->e, buf->entry_cnt,
+                                   level + 1, buf + 1);
+    }
+  return extent_cnt;
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Open inodes, keyed by sector, so that opening a single inode
+   twice returns the same `struct inode'. */
+static struct hash open_inodes;
+
+/* Protects open_inodes and the open_cnt of every inode in it,
+   and open_key. */
+static struct lock open_inodes_lock;
+
+/* Key for searching open_inodes.  A `struct inode' is too big to
+   put on the stack for the purpose. */
+static struct inode open_key;
+
+static hash_hash_func inode_hash;
+static hash_less_func inode_less;
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
-  list_init (&open_inodes);
+  if (!hash_init (&open_inodes, inode_hash, inode_less, NULL))
+    PANIC ("can't create open inode table");
+  lock_init (&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  The inode is a directory if IS_DIR is true.
+   The data is kept in the inode if it is small enough, and
+   otherwise left as a hole, which reads as zeros, so no data
+   sectors are allocated or written until they are first written
+   to.
    Returns true if successful.
-   Returns false if memory or disk allocation fails. */
+   Returns false if memory allocation fails. */
 bool
-inode_create (block_sector_t sector, off_t length)
+inode_create (block_sector_t sector, off_t length, bool is_dir)
 {
   struct inode_disk *disk_inode = NULL;
-  bool success = false;
 
   ASSERT (length >= 0);
 
@@ -82,27 +894,18 @@ inode_create (block_sector_t sector, off_t length)
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
 
   disk_inode = calloc (1, sizeof *disk_inode);
-  if (disk_inode != NULL)
-    {
-      size_t sectors = bytes_to_sectors (length);
-      disk_inode->length = length;
-      disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
-        {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
-          success = true; 
-        } 
-      free (disk_inode);
-    }
-  return success;
+  if (disk_inode == NULL)
+    return false;
+  disk_inode->length = length;
+  disk_inode->magic = INODE_MAGIC;
+  disk_inode->is_dir = is_dir;
+  disk_inode->is_inline = length <= INLINE_MAX;
+
+  journal_begin ();
+  journal_write (sector, disk_inode);
+  journal_end ();
+  free (disk_inode);
+  return true;
 }
 
 /* Reads an inode from SECTOR
@@ -111,33 +914,57 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  struct hash_elem *e;
   struct inode *inode;
 
+  lock_acquire (&open_inodes_lock);
+
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  open_key.sector = sector;
+  e = hash_find (&open_inodes, &open_key.hash_elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      inode = hash_entry (e, struct inode, hash_elem);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+
+      /* Wait for its first opener to finish reading it in. */
+      rwlock_acquire_read (&inode->rwlock);
+      rwlock_release_read (&inode->rwlock);
+      return inode;
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  /* Initialize.  The inode is read after it is added to the
+     table, so as not to hold up other openers, but it stays
+     locked until its contents are valid. */
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  rwlock_init (&inode->rwlock);
+  lock_init (&inode->map_lock);
+  lock_init (&inode->dir_lock);
+  inode->dirty = false;
+  inode->metadata = false;
+  inode->leaf_sector = 0;
+  inode->leaf = NULL;
+  inode->wbuf = NULL;
+  inode->wbuf_ofs = 0;
+  inode->wbuf_end = 0;
+  rwlock_acquire_write (&inode->rwlock);
+  hash_insert (&open_inodes, &inode->hash_elem);
+  lock_release (&open_inodes_lock);
+
+  journal_read (inode->sector, &inode->data);
+  rwlock_release_write (&inode->rwlock);
   return inode;
 }
 
@@ -146,7 +973,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -163,28 +994,95 @@ inode_get_inumber (const struct inode *inode)
 void
 inode_close (struct inode *inode) 
 {
+  bool last;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
+  /* Write back buffered data before INODE can leave the table,
+     so that it is complete on disk by the time anyone reads it
+     in again.  Only a writer fills the buffer, and it closes the
+     inode itself, so it always sees the buffer it filled.  Then
+     free the buffer, which takes many pages, even if INODE stays
+     open, as it may in the directory cache for a long time. */
+  if (inode->wbuf != NULL && !inode->removed)
+    {
+      journal_begin ();
+      rwlock_acquire_write (&inode->rwlock);
+      flush_wbuf (inode);
+      flush_inode (inode);
+      free (inode->wbuf);
+      inode->wbuf = NULL;
+      rwlock_release_write (&inode->rwlock);
+      journal_end ();
+    }
+
+  lock_acquire (&open_inodes_lock);
+  last = --inode->open_cnt == 0;
+  if (last)
+    hash_delete (&open_inodes, &inode->hash_elem);
+  lock_release (&open_inodes_lock);
+
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  if (last)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
+          journal_begin ();
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          deallocate (inode);
+          journal_end ();
         }
 
+      free (inode->leaf);
+      free (inode->wbuf);
       free (inode); 
     }
 }
 
+/* Writes back the buffered data and the changed `struct
+   inode_disk' of every open inode, so that journal_sync() can
+   then put everything on disk.  Used when the file system is
+   shutting down, with inodes that may still be open. */
+void
+inode_flush_all (void)
+{
+  struct hash_iterator i;
+
+  journal_begin ();
+  lock_acquire (&open_inodes_lock);
+  hash_first (&i, &open_inodes);
+  while (hash_next (&i))
+    {
+      struct inode *inode = hash_entry (hash_cur (&i), struct inode,
+                                        hash_elem);
+      if (inode->removed)
+        continue;
+      rwlock_acquire_write (&inode->rwlock);
+      flush_wbuf (inode);
+      flush_inode (inode);
+      rwlock_release_write (&inode->rwlock);
+    }
+  lock_release (&open_inodes_lock);
+  journal_end ();
+}
+
+/* Returns true if INODE is a directory. */
+bool
+inode_is_dir (const struct inode *inode)
+{
+  return inode->data.is_dir != 0;
+}
+
+/* Returns true if INODE has been removed. */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
 /* Marks INODE to be deleted when it is closed by the last caller who
    has it open. */
 void
@@ -202,12 +1100,43 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
+  off_t buffered = 0;
   uint8_t *bounce = NULL;
 
+  rwlock_acquire_read (&inode->rwlock);
+  if (inode->data.is_inline)
+    {
+      /* Copy straight out of the inode. */
+      off_t inode_left = inode_length (inode) - offset;
+      if (inode_left > 0)
+        {
+          bytes_read = size < inode_left ? size : inode_left;
+          memcpy (buffer, inode->data.root.data + offset, bytes_read);
+        }
+      goto done;
+    }
+
+  /* Take whatever part lies in the write buffer from there, and
+     read only what precedes it from disk. */
+  if (inode->wbuf_end > 0 && offset < inode->wbuf_end
+      && offset + size > inode->wbuf_ofs)
+    {
+      off_t start = offset > inode->wbuf_ofs ? offset : inode->wbuf_ofs;
+      off_t end = (offset + size < inode->wbuf_end
+                   ? offset + size : inode->wbuf_end);
+
+      memcpy (buffer + (start - offset),
+              inode->wbuf + (start - inode->wbuf_ofs), end - start);
+      buffered = end - start;
+      size = start - offset;
+    }
+
   while (size > 0) 
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Disk sector to read, starting byte offset within sector,
+         and number of sectors contiguous with it on disk. */
+      uint32_t run;
+      block_sector_t sector_idx;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -220,10 +1149,31 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
+      /* Stop short if the sector cannot be looked up, rather than
+         reading it as a hole. */
+      if (!lookup_sector (inode, offset / BLOCK_SECTOR_SIZE, &sector_idx,
+                          &run, NULL))
+        break;
+
+      /* Whole sectors are read a contiguous run at a time. */
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
+          off_t whole = (size < inode_left ? size : inode_left)
+                        / BLOCK_SECTOR_SIZE;
+          if (run > (uint32_t) whole)
+            run = whole;
+          chunk_size = run * BLOCK_SECTOR_SIZE;
+        }
+
+      if (sector_idx == 0)
+        {
+          /* Holes read as zeros. */
+          memset (buffer + bytes_read, 0, chunk_size);
+        }
+      else if (sector_ofs == 0 && chunk_size % BLOCK_SECTOR_SIZE == 0)
+        {
+          /* Read full sectors directly into caller's buffer. */
+          read_data (inode, sector_idx, run, buffer + bytes_read);
         }
       else 
         {
@@ -235,7 +1185,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
               if (bounce == NULL)
                 break;
             }
-          block_read (fs_device, sector_idx, bounce);
+          read_data (inode, sector_idx, 1, bounce);
           memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
         }
       
@@ -244,6 +1194,11 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  if (size == 0)
+    bytes_read += buffered;
+
+ done:
+  rwlock_release_read (&inode->rwlock);
   free (bounce);
 
   return bytes_read;
@@ -251,68 +1206,70 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk is full or an error occurs.
+   Writing past end of file extends INODE.  Any gap between the
+   old end of file and OFFSET is left as a hole that reads as
+   zeros. */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
                 off_t offset) 
 {
-  const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
 
-  if (inode->deny_write_cnt)
+  if (size <= 0)
     return 0;
-
-  while (size > 0) 
+  journal_begin ();
+  rwlock_acquire_write (&inode->rwlock);
+  if (inode->deny_write_cnt)
     {
-      /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
-      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
-
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
-      int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
+      rwlock_release_write (&inode->rwlock);
+      journal_end ();
+      return 0;
+    }
 
-      /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
-        break;
+  /* A tiny file is written in place in the inode, unless it is
+     growing too large for that. */
+  if (inode->data.is_inline)
+    {
+      if (offset + size <= INLINE_MAX)
+        {
+          memcpy (inode->data.root.data + offset, buffer, size);
+          if (offset + size > inode->data.length)
+            inode->data.length = offset + size;
+          inode->dirty = true;
+          bytes_written = size;
+          goto done;
+        }
+      if (!uninline (inode))
+        goto done;
+    }
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+  /* Appends go into the write buffer.  Any other write that
+     overlaps or follows the buffered data must first write it
+     back, after which it may start a new buffer. */
+  if (!inode->metadata)
+    {
+      if (buffer_write (inode, buffer, size, offset))
         {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
+          bytes_written = size;
+          goto done;
         }
-      else 
+      if (inode->wbuf_end > 0 && offset + size > inode->wbuf_ofs)
         {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
+          flush_wbuf (inode);
+          if (buffer_write (inode, buffer, size, offset))
             {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
+              bytes_written = size;
+              goto done;
             }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
         }
-
-      /* Advance. */
-      size -= chunk_size;
-      offset += chunk_size;
-      bytes_written += chunk_size;
     }
-  free (bounce);
+  bytes_written = write_through (inode, buffer, size, offset);
+
+ done:
+  flush_inode (inode);
+  rwlock_release_write (&inode->rwlock);
+  journal_end ();
 
   return bytes_written;
 }
@@ -322,8 +1279,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_release_write (&inode->rwlock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,14 +1291,118 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  rwlock_release_write (&inode->rwlock);
 }
 
-/* Returns the length, in bytes, of INODE's data. */
+/* Returns the length, in bytes, of INODE's data, including any
+   data in its write buffer.  This does not lock INODE.  Writing
+   back the buffer extends the length on disk before it empties
+   the buffer, so reading them in the opposite order always sees
+   either the old or the new length. */
 off_t
 inode_length (const struct inode *inode)
 {
-  return inode->data.length;
+  off_t wbuf_end = inode->wbuf_end;
+  barrier ();
+  return wbuf_end > inode->data.length ? wbuf_end : inode->data.length;
+}
+
+/* Returns the number of extents that INODE's data occupies on
+   disk, a measure of its fragmentation, or 0 if it has none or
+   memory cannot be allocated.  Data in the write buffer has no
+   extents until it is written back. */
+size_t
+inode_extent_cnt (struct inode *inode)
+{
+  struct inode_disk *d = &inode->data;
+  struct extent_node *buf = NULL;
+  size_t extent_cnt = 0;
+
+  rwlock_acquire_read (&inode->rwlock);
+  if (!d->is_inline
+      && (d->depth == 0
+          || (buf = malloc (d->depth * sizeof *buf)) != NULL))
+    extent_cnt = count_extents (inode, &d->root, d->entry_cnt, 0, buf);
+  rwlock_release_read (&inode->rwlock);
+  free (buf);
+  return extent_cnt;
+}
+
+/* Acquires INODE's directory lock, which serializes operations
+   on the entries of a directory stored in INODE. */
+void
+inode_lock (struct inode *inode)
+{
+  lock_acquire (&inode->dir_lock);
+}
+
+/* Releases INODE's directory lock. */
+void
+inode_unlock (struct inode *inode)
+{
+  lock_release (&inode->dir_lock);
+}
+
+/* Marks INODE as holding metadata, such as a directory or the
+   free map, so that writes to its data go through the journal
+   like writes to the inode itself. */
+void
+inode_set_metadata (struct inode *inode)
+{
+  inode->metadata = true;
+}
+
+/* Reads CNT consecutive data sectors of INODE, starting at disk
+   sector SECTOR, into BUFFER. */
+static void
+read_data (struct inode *inode, block_sector_t sector, block_sector_t cnt,
+           void *buffer)
+{
+  uint8_t *p = buffer;
+  block_sector_t i;
+
+  if (inode->metadata)
+    for (i = 0; i < cnt; i++)
+      journal_read (sector + i, p + i * BLOCK_SECTOR_SIZE);
+  else
+    block_read_multi (fs_device, sector, cnt, buffer);
+}
+
+/* Writes CNT consecutive data sectors of INODE, starting at disk
+   sector SECTOR, from BUFFER: through the journal if INODE holds
+   metadata, otherwise in place. */
+static void
+write_data (struct inode *inode, block_sector_t sector, block_sector_t cnt,
+            const void *buffer)
+{
+  const uint8_t *p = buffer;
+  block_sector_t i;
+
+  if (inode->metadata)
+    for (i = 0; i < cnt; i++)
+      journal_write (sector + i, p + i * BLOCK_SECTOR_SIZE);
+  else
+    journal_write_direct (sector, cnt, buffer);
+}
+
+/* Returns a hash value for the inode that contains E. */
+static unsigned
+inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct inode *inode = hash_entry (e, struct inode, hash_elem);
+  return hash_bytes (&inode->sector, sizeof inode->sector);
+}
+
+/* Returns true if inode A's sector precedes inode B's. */
+static bool
+inode_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct inode *a = hash_entry (a_, struct inode, hash_elem);
+  const struct inode *b = hash_entry (b_, struct inode, hash_elem);
+  return a->sector < b->sector;
 }
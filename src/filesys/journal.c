@@ -0,0 +1,551 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Write-ahead metadata journal.
+
+   Changes to metadata (inodes, extent tree nodes, directories
+   and the free map) are not written in place right away.
+   Instead, journal_write() keeps a copy of each changed sector in
+   the running transaction, which every operation between
+   journal_begin() and journal_end() joins.  Once enough has
+   accumulated and no operation is in progress, the transaction is
+   committed: its sectors are appended to the log, followed by a
+   commit record.  Committed sectors are only written to their
+   home locations ("checkpointed") when the log fills up or at
+   journal_sync().  Many operations thus share each commit, and a
+   sector that many of them change is written home only once.
+
+   After a crash, journal_recover() replays every transaction in
+   the log that has a commit record, so each operation is either
+   entirely on disk or not at all.  File data is not journaled: it
+   is written in place, with journal_write_direct(), before the
+   metadata that refers to it is committed.
+
+   The journal occupies JOURNAL_SIZE sectors starting at
+   JOURNAL_SECTOR.  The first holds a `struct journal_header',
+   which gives the sequence number of the first transaction in the
+   log.  The log fills the rest.  Each transaction in it is one or
+   more `struct journal_desc' records, each followed by the
+   sectors that it lists, and then a `struct journal_commit'. */
+
+#define JOURNAL_MAGIC 0x4a524e4c        /* Identifies journal header. */
+#define DESC_MAGIC 0x4a444553           /* Identifies a descriptor. */
+#define COMMIT_MAGIC 0x4a434d54         /* Identifies a commit record. */
+
+/* Number of sectors listed by a descriptor. */
+#define DESC_CNT ((BLOCK_SECTOR_SIZE - 3 * sizeof (uint32_t)) \
+                  / sizeof (block_sector_t))
+
+/* Commit once the running transaction holds this many sectors. */
+#define COMMIT_CNT 64
+
+/* Journal header.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_header
+  {
+    uint32_t magic;                     /* JOURNAL_MAGIC. */
+    uint32_t seq;                       /* First transaction in log. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 8];
+  };
+
+/* Lists the home sectors of the CNT logged sectors that follow.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_desc
+  {
+    uint32_t magic;                     /* DESC_MAGIC. */
+    uint32_t seq;                       /* Transaction. */
+    uint32_t cnt;                       /* Number of sectors. */
+    block_sector_t sectors[DESC_CNT];   /* Home sectors. */
+  };
+
+/* Marks the end of a complete transaction.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_commit
+  {
+    uint32_t magic;                     /* COMMIT_MAGIC. */
+    uint32_t seq;                       /* Transaction. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 8];
+  };
+
+/* A metadata sector held by the journal. */
+struct jsector
+  {
+    struct hash_elem elem;              /* Element in running or committed. */
+    block_sector_t sector;              /* Home sector. */
+    uint8_t data[BLOCK_SECTOR_SIZE];    /* Contents. */
+  };
+
+static struct lock journal_lock;        /* Protects all of the below. */
+static struct condition quiet;          /* Signaled as work finishes. */
+static struct hash running;             /* Running transaction. */
+static struct hash committed;           /* Committed, not checkpointed. */
+static int active_cnt;                  /* Operations in progress. */
+static struct thread *committer;        /* Thread committing, if any. */
+static uint32_t seq;                    /* Running transaction's number. */
+static size_t log_head;                 /* Next log sector to write. */
+
+/* Statistics. */
+static unsigned long long meta_cnt;     /* Metadata sector writes. */
+static unsigned long long log_cnt;      /* Sectors written to log. */
+static unsigned long long home_cnt;     /* Sectors checkpointed. */
+static unsigned long long commit_cnt;   /* Transactions committed. */
+
+static hash_hash_func jsector_hash;
+static hash_less_func jsector_less;
+static void jsector_destroy (struct hash_elem *, void *);
+static struct jsector *find (struct hash *, block_sector_t);
+static void write_header (void);
+static void commit (bool checkpoint_after);
+static void write_log (void);
+static void log_record (uint8_t *stage, size_t stage_head,
+                        const void *record);
+static void checkpoint (void);
+
+/* Initializes the journal module. */
+void
+journal_init (void)
+{
+  ASSERT (sizeof (struct journal_header) == BLOCK_SECTOR_SIZE);
+  ASSERT (sizeof (struct journal_desc) == BLOCK_SECTOR_SIZE);
+  ASSERT (sizeof (struct journal_commit) == BLOCK_SECTOR_SIZE);
+
+  lock_init (&journal_lock);
+  cond_init (&quiet);
+  if (!hash_init (&running, jsector_hash, jsector_less, NULL)
+      || !hash_init (&committed, jsector_hash, jsector_less, NULL))
+    PANIC ("can't create journal tables");
+}
+
+/* Writes an empty journal to disk. */
+void
+journal_create (void)
+{
+  static const uint8_t zeros[BLOCK_SECTOR_SIZE];
+
+  seq = 1;
+  write_header ();
+
+  /* Invalidate whatever the log held before. */
+  block_write (fs_device, JOURNAL_SECTOR + 1, zeros);
+}
+
+/* Replays every committed transaction in the journal on disk,
+   then empties it. */
+void
+journal_recover (void)
+{
+  struct journal_desc *desc;
+  uint8_t *buf, *image;
+  block_sector_t *homes, *sources;
+  size_t pos = 1;
+  int replay_cnt = 0;
+
+  buf = malloc (BLOCK_SECTOR_SIZE);
+  image = malloc (BLOCK_SECTOR_SIZE);
+  homes = malloc (JOURNAL_SIZE * sizeof *homes);
+  sources = malloc (JOURNAL_SIZE * sizeof *sources);
+  if (buf == NULL || image == NULL || homes == NULL || sources == NULL)
+    PANIC ("can't allocate memory for journal recovery");
+
+  block_read (fs_device, JOURNAL_SECTOR, buf);
+  if (((struct journal_header *) buf)->magic != JOURNAL_MAGIC)
+    PANIC ("file system has no journal");
+  seq = ((struct journal_header *) buf)->seq;
+
+  desc = (struct journal_desc *) buf;
+  for (;;)
+    {
+      const struct journal_commit *c = (const struct journal_commit *) buf;
+      size_t cnt = 0, i;
+
+      /* Gather the transaction's descriptors. */
+      for (;;)
+        {
+          if (pos >= JOURNAL_SIZE)
+            goto done;
+          block_read (fs_device, JOURNAL_SECTOR + pos, buf);
+          if (desc->magic != DESC_MAGIC || desc->seq != seq
+              || desc->cnt > DESC_CNT || pos + 1 + desc->cnt >= JOURNAL_SIZE)
+            break;
+          for (i = 0; i < desc->cnt; i++)
+            {
+              homes[cnt] = desc->sectors[i];
+              sources[cnt++] = JOURNAL_SECTOR + pos + 1 + i;
+            }
+          pos += 1 + desc->cnt;
+        }
+
+      /* Replay it if it was committed. */
+      if (c->magic != COMMIT_MAGIC || c->seq != seq)
+        break;
+      for (i = 0; i < cnt; i++)
+        {
+          block_read (fs_device, sources[i], image);
+          block_write (fs_device, homes[i], image);
+        }
+      pos++;
+      seq++;
+      replay_cnt++;
+    }
+
+ done:
+  if (replay_cnt > 0)
+    printf ("journal: replayed %d transaction%s\n",
+            replay_cnt, replay_cnt != 1 ? "s" : "");
+  write_header ();
+  free (sources);
+  free (homes);
+  free (image);
+  free (buf);
+}
+
+/* Commits the running transaction and checkpoints the journal,
+   so that everything written so far is in its home location.
+   Waits for operations in progress to finish first. */
+void
+journal_sync (void)
+{
+  lock_acquire (&journal_lock);
+  while (committer != NULL || active_cnt > 0)
+    cond_wait (&quiet, &journal_lock);
+  commit (true);
+  lock_release (&journal_lock);
+}
+
+/* Begins an operation, whose metadata changes will all be
+   committed together.  Operations may nest. */
+void
+journal_begin (void)
+{
+  lock_acquire (&journal_lock);
+  while (committer != NULL && committer != thread_current ())
+    cond_wait (&quiet, &journal_lock);
+  active_cnt++;
+  lock_release (&journal_lock);
+}
+
+/* Ends an operation begun with journal_begin().  If it was the
+   last one in progress, commits the running transaction if it
+   has grown large enough, or if the free map is waiting for
+   space to be released. */
+void
+journal_end (void)
+{
+  lock_acquire (&journal_lock);
+  ASSERT (active_cnt > 0);
+  if (--active_cnt == 0)
+    {
+      if (committer == NULL
+          && (hash_size (&running) >= COMMIT_CNT || free_map_needs_flush ()))
+        commit (false);
+      cond_broadcast (&quiet, &journal_lock);
+    }
+  lock_release (&journal_lock);
+}
+
+/* Reads SECTOR into BUFFER, as last written through the
+   journal. */
+void
+journal_read (block_sector_t sector, void *buffer)
+{
+  struct jsector *j;
+
+  lock_acquire (&journal_lock);
+  j = find (&running, sector);
+  if (j == NULL)
+    j = find (&committed, sector);
+  if (j != NULL)
+    memcpy (buffer, j->data, BLOCK_SECTOR_SIZE);
+  lock_release (&journal_lock);
+
+  if (j == NULL)
+    block_read (fs_device, sector, buffer);
+}
+
+/* Writes metadata SECTOR from BUFFER as part of the running
+   transaction.  Must be called between journal_begin() and
+   journal_end(). */
+void
+journal_write (block_sector_t sector, const void *buffer)
+{
+  struct jsector *j;
+
+  lock_acquire (&journal_lock);
+  ASSERT (active_cnt > 0);
+  meta_cnt++;
+  j = find (&running, sector);
+  if (j == NULL)
+    {
+      j = malloc (sizeof *j);
+      if (j == NULL)
+        {
+          /* Out of memory.  Write in place, without the
+             protection of the journal, after anything older. */
+          checkpoint ();
+          block_write (fs_device, sector, buffer);
+          home_cnt++;
+          lock_release (&journal_lock);
+          return;
+        }
+      j->sector = sector;
+      hash_insert (&running, &j->elem);
+    }
+  memcpy (j->data, buffer, BLOCK_SECTOR_SIZE);
+  lock_release (&journal_lock);
+}
+
+/* Writes CNT sectors of file data starting at SECTOR from BUFFER
+   in place, as a single device request.  If the journal holds an
+   older copy of any of them from when it was metadata, that is
+   checkpointed first, so that it cannot later overwrite the data,
+   and a copy still in the running transaction is updated to
+   match. */
+void
+journal_write_direct (block_sector_t sector, block_sector_t cnt,
+                      const void *buffer)
+{
+  const uint8_t *p = buffer;
+  block_sector_t i;
+
+  lock_acquire (&journal_lock);
+  for (i = 0; i < cnt; i++)
+    if (find (&committed, sector + i) != NULL)
+      {
+        checkpoint ();
+        break;
+      }
+  if (!hash_empty (&running))
+    for (i = 0; i < cnt; i++)
+      {
+        struct jsector *j = find (&running, sector + i);
+        if (j != NULL)
+          memcpy (j->data, p + i * BLOCK_SECTOR_SIZE, BLOCK_SECTOR_SIZE);
+      }
+  lock_release (&journal_lock);
+
+  block_write_multi (fs_device, sector, cnt, buffer);
+}
+
+/* Prints journal statistics. */
+void
+journal_print_stats (void)
+{
+  printf ("Journal: %llu metadata writes, %llu commits, "
+          "%llu log writes, %llu checkpoint writes\n",
+          meta_cnt, commit_cnt, log_cnt, home_cnt);
+}
+
+/* Returns a hash value for the jsector that contains E. */
+static unsigned
+jsector_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct jsector *j = hash_entry (e, struct jsector, elem);
+  return hash_bytes (&j->sector, sizeof j->sector);
+}
+
+/* Returns true if jsector A's sector precedes B's. */
+static bool
+jsector_less (const struct hash_elem *a_, const struct hash_elem *b_,
+              void *aux UNUSED)
+{
+  const struct jsector *a = hash_entry (a_, struct jsector, elem);
+  const struct jsector *b = hash_entry (b_, struct jsector, elem);
+  return a->sector < b->sector;
+}
+
+/* Frees the jsector that contains E. */
+static void
+jsector_destroy (struct hash_elem *e, void *aux UNUSED)
+{
+  free (hash_entry (e, struct jsector, elem));
+}
+
+/* Returns the jsector for SECTOR in TABLE, or a null pointer if
+   there is none. */
+static struct jsector *
+find (struct hash *table, block_sector_t sector)
+{
+  struct jsector key;
+  struct hash_elem *e;
+
+  key.sector = sector;
+  e = hash_find (table, &key.elem);
+  return e != NULL ? hash_entry (e, struct jsector, elem) : NULL;
+}
+
+/* Writes the journal header, making the log start with
+   transaction SEQ at its beginning, and empties the log. */
+static void
+write_header (void)
+{
+  struct journal_header *h = calloc (1, sizeof *h);
+  if (h == NULL)
+    PANIC ("can't allocate journal header");
+  h->magic = JOURNAL_MAGIC;
+  h->seq = seq;
+  block_write (fs_device, JOURNAL_SECTOR, h);
+  free (h);
+  log_head = 1;
+}
+
+/* Commits the running transaction, and checkpoints the journal
+   afterward if CHECKPOINT_AFTER.  No operation may be in
+   progress.  The journal lock must be held; it is released while
+   the free map adds its own changes to the transaction. */
+static void
+commit (bool checkpoint_after)
+{
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  ASSERT (committer == NULL && active_cnt == 0);
+
+  committer = thread_current ();
+  lock_release (&journal_lock);
+  free_map_flush ();
+  lock_acquire (&journal_lock);
+
+  ASSERT (active_cnt == 0);
+  write_log ();
+  if (checkpoint_after)
+    checkpoint ();
+  committer = NULL;
+  cond_broadcast (&quiet, &journal_lock);
+}
+
+/* Appends the running transaction to the log, followed by a
+   commit record, and moves its sectors to the committed set.
+   Checkpoints first if the log is too full.  A transaction too
+   large for the log, or when memory is short, is written in
+   place instead, without the protection of the journal. */
+static void
+write_log (void)
+{
+  size_t cnt = hash_size (&running);
+  size_t records = cnt + DIV_ROUND_UP (cnt, DESC_CNT) + 1;
+  struct jsector **list;
+  struct journal_desc *desc;
+  struct hash_iterator i;
+  size_t n;
+
+  if (cnt == 0)
+    return;
+  if (log_head + records > JOURNAL_SIZE)
+    checkpoint ();
+
+  /* Gather the transaction's sectors. */
+  list = malloc (cnt * sizeof *list);
+  desc = calloc (1, sizeof *desc);
+  n = 0;
+  hash_first (&i, &running);
+  while (list != NULL && hash_next (&i))
+    list[n++] = hash_entry (hash_cur (&i), struct jsector, elem);
+
+  if (list == NULL || desc == NULL || log_head + records > JOURNAL_SIZE)
+    {
+      /* Checkpoint first, so that an older committed copy of one
+         of these sectors can neither be read back in place of
+         the new one nor later written over it. */
+      if (!hash_empty (&committed))
+        checkpoint ();
+      hash_first (&i, &running);
+      while (hash_next (&i))
+        {
+          struct jsector *j = hash_entry (hash_cur (&i), struct jsector, elem);
+          block_write (fs_device, j->sector, j->data);
+          home_cnt++;
+        }
+      hash_clear (&running, jsector_destroy);
+    }
+  else
+    {
+      /* Write descriptors and sectors, gathered into STAGE so
+         that they go to the log in a single device request, or
+         one at a time if there is no memory for that.  Then
+         write the commit record in a request of its own, so that
+         it cannot reach the disk before the records it
+         covers. */
+      struct journal_commit *c = (struct journal_commit *) desc;
+      uint8_t *stage = malloc ((records - 1) * BLOCK_SECTOR_SIZE);
+      size_t stage_head = log_head;
+
+      for (n = 0; n < cnt; )
+        {
+          size_t first = n;
+
+          desc->magic = DESC_MAGIC;
+          desc->seq = seq;
+          desc->cnt = cnt - n < DESC_CNT ? cnt - n : DESC_CNT;
+          for (; n < first + desc->cnt; n++)
+            desc->sectors[n - first] = list[n]->sector;
+          log_record (stage, stage_head, desc);
+          for (n = first; n < first + desc->cnt; n++)
+            log_record (stage, stage_head, list[n]->data);
+          log_cnt += 1 + desc->cnt;
+        }
+      if (stage != NULL)
+        block_write_multi (fs_device, JOURNAL_SECTOR + stage_head,
+                           log_head - stage_head, stage);
+      free (stage);
+
+      memset (c, 0, sizeof *c);
+      c->magic = COMMIT_MAGIC;
+      c->seq = seq;
+      block_write (fs_device, JOURNAL_SECTOR + log_head++, c);
+      log_cnt++;
+
+      /* The sectors are now committed, replacing any older
+         copies. */
+      hash_clear (&running, NULL);
+      for (n = 0; n < cnt; n++)
+        {
+          struct hash_elem *old = hash_replace (&committed, &list[n]->elem);
+          if (old != NULL)
+            jsector_destroy (old, NULL);
+        }
+    }
+  seq++;
+  commit_cnt++;
+  free (desc);
+  free (list);
+}
+
+/* Appends the sector of data at RECORD to the log.  If STAGE is
+   non-null, copies it there, at its offset from log sector
+   STAGE_HEAD, for the caller to write later; otherwise, writes it
+   to disk. */
+static void
+log_record (uint8_t *stage, size_t stage_head, const void *record)
+{
+  if (stage != NULL)
+    memcpy (stage + (log_head - stage_head) * BLOCK_SECTOR_SIZE, record,
+            BLOCK_SECTOR_SIZE);
+  else
+    block_write (fs_device, JOURNAL_SECTOR + log_head, record);
+  log_head++;
+}
+
+/* Writes every committed sector to its home location and empties
+   the log. */
+static void
+checkpoint (void)
+{
+  struct hash_iterator i;
+
+  hash_first (&i, &committed);
+  while (hash_next (&i))
+    {
+      struct jsector *j = hash_entry (hash_cur (&i), struct jsector, elem);
+      block_write (fs_device, j->sector, j->data);
+      home_cnt++;
+    }
+  hash_clear (&committed, jsector_destroy);
+  write_header ();
+}
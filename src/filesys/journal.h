@@ -0,0 +1,24 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Number of sectors in the journal, starting at JOURNAL_SECTOR. */
+#define JOURNAL_SIZE 256
+
+void journal_init (void);
+void journal_create (void);
+void journal_recover (void);
+void journal_sync (void);
+
+void journal_begin (void);
+void journal_end (void);
+
+void journal_read (block_sector_t, void *);
+void journal_write (block_sector_t, const void *);
+void journal_write_direct (block_sector_t, block_sector_t cnt, const void *);
+
+void journal_print_stats (void);
+
+#endif /* filesys/journal.h */
@@ -69,6 +69,73 @@ last_mask (const struct bitmap *b)
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns the element of B's bits numbered IDX, inverted if
+   VALUE is false, so that the bits set to VALUE are 1s. */
+static inline elem_type
+elem_value (const struct bitmap *b, size_t idx, bool value)
+{
+  return value ? b->bits[idx] : ~b->bits[idx];
+}
+
+/* Returns a mask of the bits in an element that represent bits
+   START through END - 1 of the bitmap, inclusive, where START
+   and END are relative to the start of the element and
+   0 <= START < END <= ELEM_BITS. */
+static inline elem_type
+range_mask (size_t start, size_t end)
+{
+  elem_type high = (end < ELEM_BITS
+                    ? ((elem_type) 1 << end) - 1 : (elem_type) -1);
+  return high & ((elem_type) -1 << start);
+}
+
+/* Returns the index of the lowest 1 bit in X, which must be
+   nonzero, using the BSF instruction.  See [IA32-v2a]. */
+static inline size_t
+lowest_bit (elem_type x)
+{
+  elem_type bit;
+  asm ("bsfl %1, %0" : "=r" (bit) : "rm" (x) : "cc");
+  return bit;
+}
+
+/* Returns the number of 1 bits in X. */
+static inline size_t
+count_bits (elem_type x)
+{
+  /* Adds up adjacent bits, then pairs, then nibbles, and then
+     sums the bytes with a multiply.  This relies on elem_type
+     being 32 bits wide, as it is on the 80x86. */
+  x = x - ((x >> 1) & 0x55555555);
+  x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+  x = (x + (x >> 4)) & 0x0f0f0f0f;
+  return (elem_type) (x * 0x01010101) >> 24;
+}
+
+/* Returns the index of the first bit in B at or after START, and
+   before END, that is set to VALUE, or END if there is none.
+   Whole elements without such a bit are skipped at once. */
+static size_t
+find_next (const struct bitmap *b, size_t start, size_t end, bool value)
+{
+  size_t idx;
+  elem_type e;
+
+  if (start >= end)
+    return end;
+
+  idx = elem_idx (start);
+  e = elem_value (b, idx, value) & ((elem_type) -1 << (start % ELEM_BITS));
+  while (e == 0)
+    {
+      if (++idx >= elem_cnt (end))
+        return end;
+      e = elem_value (b, idx, value);
+    }
+  start = idx * ELEM_BITS + lowest_bit (e);
+  return start < end ? start : end;
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -214,18 +281,34 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Elements wholly inside the range are stored in one go.  The
+   partial elements at either end are updated atomically, like
+   single bits, so as not to disturb the bits outside the range. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end = start + cnt;
+  size_t idx;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  for (idx = elem_idx (start); idx * ELEM_BITS < end; idx++)
+    {
+      size_t first = idx * ELEM_BITS;
+      elem_type mask = range_mask (start > first ? start - first : 0,
+                                   end - first < ELEM_BITS
+                                   ? end - first : ELEM_BITS);
+
+      if (mask == (elem_type) -1)
+        b->bits[idx] = value ? mask : 0;
+      else if (value)
+        asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -233,16 +316,22 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t end = start + cnt;
+  size_t idx, value_cnt;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
   value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
+  for (idx = elem_idx (start); idx * ELEM_BITS < end; idx++)
+    {
+      size_t first = idx * ELEM_BITS;
+      elem_type mask = range_mask (start > first ? start - first : 0,
+                                   end - first < ELEM_BITS
+                                   ? end - first : ELEM_BITS);
+      value_cnt += count_bits (elem_value (b, idx, value) & mask);
+    }
   return value_cnt;
 }
 
@@ -251,16 +340,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_next (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -292,20 +376,35 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+   Each candidate group begins at a bit set to VALUE and, if it
+   is too short, ends at a bit set to !VALUE, after which the
+   search resumes, so every element is examined only a bounded
+   number of times. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
+  if (cnt == 0)
+    return start;
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t i = start;
+      while (i <= last)
+        {
+          size_t end;
+
+          i = find_next (b, i, last + 1, value);
+          if (i > last)
+            break;
+          end = find_next (b, i, i + cnt, !value);
+          if (end == i + cnt)
+            return i;
+          i = end + 1;
+        }
     }
   return BITMAP_ERROR;
 }
@@ -359,6 +458,23 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the SIZE bytes of B that begin at byte offset OFS to
+   the same offset in FILE, where bitmap_write() would put them,
+   stopping at the end of B.  Return true if successful, false
+   otherwise. */
+bool
+bitmap_write_part (const struct bitmap *b, struct file *file,
+                   size_t ofs, size_t size)
+{
+  size_t total = byte_cnt (b->bit_cnt);
+  if (ofs >= total)
+    return true;
+  if (size > total - ofs)
+    size = total - ofs;
+  return (size_t) file_write_at (file, (const uint8_t *) b->bits + ofs,
+                                 size, ofs) == size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
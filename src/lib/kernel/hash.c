@@ -18,6 +18,7 @@ static struct hash_elem *find_elem (struct hash *, struct list *,
 static void insert_elem (struct hash *, struct list *, struct hash_elem *);
 static void remove_elem (struct hash *, struct hash_elem *);
 static void rehash (struct hash *);
+static void move_buckets (struct hash *, size_t cnt);
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -28,6 +29,9 @@ hash_init (struct hash *h,
   h->elem_cnt = 0;
   h->bucket_cnt = 4;
   h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+  h->old_buckets = NULL;
+  h->old_bucket_cnt = 0;
+  h->move_idx = 0;
   h->hash = hash;
   h->less = less;
   h->aux = aux;
@@ -55,6 +59,7 @@ hash_clear (struct hash *h, hash_action_func *destructor)
 {
   size_t i;
 
+  move_buckets (h, SIZE_MAX);
   for (i = 0; i < h->bucket_cnt; i++) 
     {
       struct list *bucket = &h->buckets[i];
@@ -89,6 +94,7 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
   if (destructor != NULL)
     hash_clear (h, destructor);
   free (h->buckets);
+  free (h->old_buckets);
 }
 
 /* Inserts NEW into hash table H and returns a null pointer, if
@@ -166,6 +172,7 @@ hash_apply (struct hash *h, hash_action_func *action)
   
   ASSERT (action != NULL);
 
+  move_buckets (h, SIZE_MAX);
   for (i = 0; i < h->bucket_cnt; i++) 
     {
       struct list *bucket = &h->buckets[i];
@@ -202,6 +209,9 @@ hash_first (struct hash_iterator *i, struct hash *h)
   ASSERT (i != NULL);
   ASSERT (h != NULL);
 
+  /* Iteration visits every element anyway, so finish any resize
+     in progress, leaving only one array of buckets to walk. */
+  move_buckets (h, SIZE_MAX);
   i->hash = h;
   i->bucket = i->hash->buckets;
   i->elem = list_elem_to_hash_elem (list_head (i->bucket));
@@ -308,12 +318,22 @@ hash_ptr (const void *p)
   return hash_bytes (&p, sizeof p);  
 }
 
-/* Returns the bucket in H that E belongs in. */
+/* Returns the bucket in H that E belongs in.  While H is being
+   resized, that is its old bucket if the old bucket has not yet
+   been moved, and its new bucket otherwise, so that an element
+   is always found in just one place. */
 static struct list *
 find_bucket (struct hash *h, struct hash_elem *e) 
 {
-  size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
-  return &h->buckets[bucket_idx];
+  unsigned hash = h->hash (e, h->aux);
+
+  if (h->old_buckets != NULL)
+    {
+      size_t old_idx = hash & (h->old_bucket_cnt - 1);
+      if (old_idx >= h->move_idx)
+        return &h->old_buckets[old_idx];
+    }
+  return &h->buckets[hash & (h->bucket_cnt - 1)];
 }
 
 /* Searches BUCKET in H for a hash element equal to E.  Returns
@@ -351,22 +371,30 @@ is_power_of_2 (size_t x)
 #define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
 #define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
 
+/* Number of old buckets moved by each insertion or deletion
+   while the table is being resized. */
+#define MOVE_BUCKETS 4
+
 /* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
-   condition, but that'll just make hash accesses less efficient;
-   we can still continue. */
+   ideal.  Only the new buckets are allocated here.  The elements
+   follow MOVE_BUCKETS old buckets at a time, on this call and
+   later ones, and no new resize begins until they all have.
+   This function can fail because of an out-of-memory condition,
+   but that'll just make hash accesses less efficient; we can
+   still continue. */
 static void
 rehash (struct hash *h) 
 {
-  size_t old_bucket_cnt, new_bucket_cnt;
-  struct list *new_buckets, *old_buckets;
-  size_t i;
+  size_t new_bucket_cnt;
+  struct list *new_buckets;
 
   ASSERT (h != NULL);
 
-  /* Save old bucket info for later use. */
-  old_buckets = h->buckets;
-  old_bucket_cnt = h->bucket_cnt;
+  if (h->old_buckets != NULL)
+    {
+      move_buckets (h, MOVE_BUCKETS);
+      return;
+    }
 
   /* Calculate the number of buckets to use now.
      We want one bucket for about every BEST_ELEMS_PER_BUCKET.
@@ -379,10 +407,11 @@ rehash (struct hash *h)
     new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
 
   /* Don't do anything if the bucket count wouldn't change. */
-  if (new_bucket_cnt == old_bucket_cnt)
+  if (new_bucket_cnt == h->bucket_cnt)
     return;
 
-  /* Allocate new buckets and initialize them as empty. */
+  /* Allocate new buckets.  They are initialized as the old
+     buckets that feed them are moved. */
   new_buckets = malloc (sizeof *new_buckets * new_bucket_cnt);
   if (new_buckets == NULL) 
     {
@@ -391,20 +420,44 @@ rehash (struct hash *h)
          there's no reason for it to be an error. */
       return;
     }
-  for (i = 0; i < new_bucket_cnt; i++) 
-    list_init (&new_buckets[i]);
 
-  /* Install new bucket info. */
+  /* Install new bucket info, keeping the old buckets until they
+     have been emptied. */
+  h->old_buckets = h->buckets;
+  h->old_bucket_cnt = h->bucket_cnt;
+  h->move_idx = 0;
   h->buckets = new_buckets;
   h->bucket_cnt = new_bucket_cnt;
 
-  /* Move each old element into the appropriate new bucket. */
-  for (i = 0; i < old_bucket_cnt; i++) 
+  move_buckets (h, MOVE_BUCKETS);
+}
+
+/* Moves the elements of up to CNT more old buckets of H into the
+   new buckets, and frees the old buckets once they are all
+   empty.  Does nothing if H is not being resized. */
+static void
+move_buckets (struct hash *h, size_t cnt)
+{
+  if (h->old_buckets == NULL)
+    return;
+
+  for (; cnt > 0 && h->move_idx < h->old_bucket_cnt; cnt--)
     {
-      struct list *old_bucket;
+      size_t idx = h->move_idx++;
+      struct list *old_bucket = &h->old_buckets[idx];
       struct list_elem *elem, *next;
-
-      old_bucket = &old_buckets[i];
+      size_t i;
+
+      /* Initialize the new buckets that only this old bucket
+         feeds: those with the same low-order bits when the table
+         grows, or the one with the same index when it shrinks.
+         Nothing can be in them before now. */
+      for (i = idx; i < h->bucket_cnt; i += h->old_bucket_cnt)
+        list_init (&h->buckets[i]);
+
+      /* Move each old element into the appropriate new bucket.
+         Now that MOVE_IDX is past this bucket, find_bucket()
+         returns the new one. */
       for (elem = list_begin (old_bucket);
            elem != list_end (old_bucket); elem = next) 
         {
@@ -416,7 +469,11 @@ rehash (struct hash *h)
         }
     }
 
-  free (old_buckets);
+  if (h->move_idx == h->old_bucket_cnt)
+    {
+      free (h->old_buckets);
+      h->old_buckets = NULL;
+    }
 }
 
 /* Inserts E into BUCKET (in hash table H). */
@@ -55,12 +55,21 @@ typedef bool hash_less_func (const struct hash_elem *a,
    data AUX. */
 typedef void hash_action_func (struct hash_elem *e, void *aux);
 
-/* Hash table. */
+/* Hash table.
+
+   When the table is resized, its elements move to the new buckets
+   a few old buckets at a time, on each insertion or deletion,
+   rather than all at once, so that no single operation takes
+   time proportional to the size of the table.  Until they have
+   all moved, OLD_BUCKETS holds the buckets being emptied. */
 struct hash 
   {
     size_t elem_cnt;            /* Number of elements in table. */
     size_t bucket_cnt;          /* Number of buckets, a power of 2. */
     struct list *buckets;       /* Array of `bucket_cnt' lists. */
+    struct list *old_buckets;   /* Buckets being moved from, or null. */
+    size_t old_bucket_cnt;      /* Number of old buckets, a power of 2. */
+    size_t move_idx;            /* Old buckets already moved. */
     hash_hash_func *hash;       /* Hash function. */
     hash_less_func *less;       /* Comparison function. */
     void *aux;                  /* Auxiliary data for `hash' and `less'. */
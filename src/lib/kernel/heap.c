@@ -0,0 +1,182 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Pairing heap, after Fredman, Sedgewick, Sleator and Tarjan,
+   "The Pairing Heap: A New Form of Self-Adjusting Heap",
+   Algorithmica 1 (1986).
+
+   The heap is a tree in which every element is no less than its
+   parent, so the root is the least element.  Each element keeps
+   its children in a doubly linked list, through the children's
+   `next' and `prev' members, with the first child's `prev'
+   pointing back to the parent.  Two trees merge in O(1) time by
+   making the root that is not less the first child of the other.
+   Removing the root merges its children in pairs, left to right,
+   then merges the pairs into one tree, right to left; this
+   second pass is what gives the O(log n) amortized bound. */
+
+static struct heap_elem *link (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+
+/* Initializes H as an empty heap that orders its elements using
+   LESS, given auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->size = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_insert (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  h->root = h->root != NULL ? link (h, h->root, e) : e;
+  h->size++;
+}
+
+/* Returns the least element in H, or a null pointer if H is
+   empty. */
+struct heap_elem *
+heap_min (struct heap *h)
+{
+  return h->root;
+}
+
+/* Removes and returns the least element in H, or returns a null
+   pointer if H is empty. */
+struct heap_elem *
+heap_pop_min (struct heap *h)
+{
+  struct heap_elem *min = h->root;
+
+  if (min != NULL)
+    {
+      h->root = merge_pairs (h, min->child);
+      h->size--;
+    }
+  return min;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  struct heap_elem *children;
+
+  ASSERT (e != NULL);
+  ASSERT (h->size > 0);
+
+  if (e == h->root)
+    {
+      heap_pop_min (h);
+      return;
+    }
+
+  /* Cut E, with its subtree, out of its parent's children... */
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+
+  /* ...and merge its children back in. */
+  children = merge_pairs (h, e->child);
+  if (children != NULL)
+    h->root = link (h, h->root, children);
+  h->size--;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (struct heap *h)
+{
+  return h->size;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (struct heap *h)
+{
+  return h->root == NULL;
+}
+
+/* Merges the trees rooted at A and B, which have no siblings or
+   parents, and returns the root of the merged tree. */
+static struct heap_elem *
+link (struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+  if (h->less (b, a, h->aux))
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  b->prev = a;
+  a->child = b;
+  return a;
+}
+
+/* Merges the trees in the sibling list that starts at FIRST into
+   one tree, and returns its root, or a null pointer if FIRST is
+   null. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root;
+
+  /* Merge adjacent trees in pairs, left to right, pushing each
+     result onto PAIRS, so that PAIRS ends up right to left. */
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+      struct heap_elem *merged;
+
+      if (b != NULL)
+        {
+          first = b->next;
+          a->next = a->prev = b->next = b->prev = NULL;
+          merged = link (h, a, b);
+        }
+      else
+        {
+          first = NULL;
+          a->prev = NULL;
+          merged = a;
+        }
+      merged->next = pairs;
+      pairs = merged;
+    }
+  if (pairs == NULL)
+    return NULL;
+
+  /* Merge the pairs into one tree, right to left. */
+  root = pairs;
+  pairs = pairs->next;
+  root->next = NULL;
+  while (pairs != NULL)
+    {
+      struct heap_elem *next = pairs->next;
+
+      pairs->next = NULL;
+      root = link (h, root, pairs);
+      pairs = next;
+    }
+  return root;
+}
@@ -0,0 +1,102 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Pairing heap.
+
+   A priority queue that finds its least element in O(1) time,
+   inserts in O(1) time, and removes the least element, or any
+   other, in O(log n) amortized time.  It suits queues that are
+   mostly inserted into and popped from the front, which a list
+   kept in order with list_insert_ordered() makes O(n) to insert
+   into.
+
+   Like a list, the heap does not use dynamic allocation.  Each
+   structure that can be in a heap embeds a struct heap_elem
+   member, and heap_entry converts a pointer to that member back
+   to a pointer to the structure, just as list_entry does.  For
+   example:
+
+      struct foo
+        {
+          struct heap_elem elem;
+          int64_t key;
+          ...other members...
+        };
+
+      static bool
+      foo_less (const struct heap_elem *a, const struct heap_elem *b,
+                void *aux UNUSED)
+      {
+        return (heap_entry (a, struct foo, elem)->key
+                < heap_entry (b, struct foo, elem)->key);
+      }
+
+      struct heap foo_heap;
+
+      heap_init (&foo_heap, foo_less, NULL);
+      ...heap_insert (&foo_heap, &f->elem)...
+      while (!heap_empty (&foo_heap))
+        {
+          struct foo *f = heap_entry (heap_pop_min (&foo_heap),
+                                      struct foo, elem);
+          ...do something with f...
+        }
+
+   The heap is not stable: elements that are equal to each other
+   come out in no particular order.  Use a struct rb_tree from
+   rbtree.h where that order matters.
+
+   The heap does no locking and no type checking.  An element
+   must not be in more than one heap at a time. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    struct heap_elem *child;    /* First child, or null. */
+    struct heap_elem *next;     /* Next sibling, or null. */
+    struct heap_elem *prev;     /* Previous sibling, or the parent of
+                                   a first child, or null at the
+                                   root. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)                   \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child            \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Pairing heap. */
+struct heap
+  {
+    struct heap_elem *root;     /* Least element, or null if empty. */
+    size_t size;                /* Number of elements. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Insertion and removal. */
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_min (struct heap *);
+struct heap_elem *heap_pop_min (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+
+/* Properties. */
+size_t heap_size (struct heap *);
+bool heap_empty (struct heap *);
+
+#endif /* lib/kernel/heap.h */
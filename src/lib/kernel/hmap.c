@@ -0,0 +1,319 @@
+/* Open-addressing hash map.
+
+   See hmap.h for basic information. */
+
+#include "hmap.h"
+#include <string.h>
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Metadata byte values.  A full slot's byte is the low 7 bits of
+   its element's hash value, so its top bit is clear. */
+#define CTRL_EMPTY   0x80       /* Never used since last resize. */
+#define CTRL_DELETED 0xfe       /* Element deleted; probes go on. */
+
+/* Returns true if metadata byte CTRL marks a full slot. */
+static inline bool
+is_full (uint8_t ctrl)
+{
+  return (ctrl & 0x80) == 0;
+}
+
+/* Returns the metadata byte for a slot holding an element with
+   hash value HASH. */
+static inline uint8_t
+hash_ctrl (unsigned hash)
+{
+  return hash & 0x7f;
+}
+
+/* Returns the first slot to probe, in a map of SLOT_CNT slots,
+   for an element with hash value HASH.  This uses the bits that
+   hash_ctrl() does not. */
+static inline size_t
+first_slot (unsigned hash, size_t slot_cnt)
+{
+  return (hash >> 7) & (slot_cnt - 1);
+}
+
+/* Fewest slots a map ever has. */
+#define MIN_SLOTS 8
+
+static size_t find_slot (struct hmap *, struct hmap_elem *, unsigned hash);
+static bool resize (struct hmap *, size_t slot_cnt);
+
+/* Initializes map H to compute hash values using HASH and
+   compare map elements using EQUAL, given auxiliary data AUX.
+   Returns true if successful, false if memory allocation
+   failed. */
+bool
+hmap_init (struct hmap *h,
+           hmap_hash_func *hash, hmap_equal_func *equal, void *aux)
+{
+  h->elem_cnt = 0;
+  h->deleted_cnt = 0;
+  h->slot_cnt = 0;
+  h->slots = NULL;
+  h->ctrl = NULL;
+  h->hash = hash;
+  h->equal = equal;
+  h->aux = aux;
+  return resize (h, MIN_SLOTS);
+}
+
+/* Removes all the elements from H.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the map.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the map element.  However, modifying map H
+   while hmap_clear() is running, using any of the functions
+   hmap_clear(), hmap_destroy(), hmap_insert(), or hmap_delete(),
+   yields undefined behavior, whether done in DESTRUCTOR or
+   elsewhere. */
+void
+hmap_clear (struct hmap *h, hmap_action_func *destructor)
+{
+  size_t i;
+
+  if (destructor != NULL)
+    for (i = 0; i < h->slot_cnt; i++)
+      if (is_full (h->ctrl[i]))
+        destructor (h->slots[i], h->aux);
+
+  memset (h->ctrl, CTRL_EMPTY, h->slot_cnt);
+  h->elem_cnt = 0;
+  h->deleted_cnt = 0;
+}
+
+/* Destroys map H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the map, as in hmap_clear(). */
+void
+hmap_destroy (struct hmap *h, hmap_action_func *destructor)
+{
+  if (destructor != NULL)
+    hmap_clear (h, destructor);
+  free (h->slots);
+}
+
+/* Inserts NEW into map H and returns a null pointer, if no equal
+   element is already in the map.
+   If an equal element is already in the map, returns it without
+   inserting NEW.
+   If the map is full and cannot grow because memory allocation
+   fails, returns NEW itself without inserting it. */
+struct hmap_elem *
+hmap_insert (struct hmap *h, struct hmap_elem *new)
+{
+  unsigned hash = h->hash (new, h->aux);
+  size_t mask, i;
+
+  i = find_slot (h, new, hash);
+  if (i != SIZE_MAX)
+    return h->slots[i];
+
+  /* Keep at least a quarter of the slots empty, so that probe
+     sequences stay short.  Grow if most of the used slots are
+     full; otherwise just sweep away the deleted ones. */
+  if ((h->elem_cnt + h->deleted_cnt + 1) * 4 > h->slot_cnt * 3)
+    {
+      size_t slot_cnt = (h->elem_cnt * 2 >= h->slot_cnt
+                         ? h->slot_cnt * 2 : h->slot_cnt);
+
+      /* If that fails, carry on as long as one slot stays empty,
+         because every probe sequence must end at one. */
+      if (!resize (h, slot_cnt)
+          && h->elem_cnt + h->deleted_cnt + 1 >= h->slot_cnt)
+        return new;
+    }
+
+  /* Take the first slot that is not full. */
+  mask = h->slot_cnt - 1;
+  for (i = first_slot (hash, h->slot_cnt); is_full (h->ctrl[i]);
+       i = (i + 1) & mask)
+    continue;
+  if (h->ctrl[i] == CTRL_DELETED)
+    h->deleted_cnt--;
+
+  new->hash = hash;
+  h->ctrl[i] = hash_ctrl (hash);
+  h->slots[i] = new;
+  h->elem_cnt++;
+  return NULL;
+}
+
+/* Finds and returns an element equal to E in map H, or a null
+   pointer if no equal element exists in the map. */
+struct hmap_elem *
+hmap_find (struct hmap *h, struct hmap_elem *e)
+{
+  size_t i = find_slot (h, e, h->hash (e, h->aux));
+  return i != SIZE_MAX ? h->slots[i] : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in map H.
+   Returns a null pointer if no equal element existed in the
+   map.
+
+   If the elements of the map are dynamically allocated, or own
+   resources that are, then it is the caller's responsibility to
+   deallocate them. */
+struct hmap_elem *
+hmap_delete (struct hmap *h, struct hmap_elem *e)
+{
+  size_t i = find_slot (h, e, h->hash (e, h->aux));
+  struct hmap_elem *found;
+
+  if (i == SIZE_MAX)
+    return NULL;
+
+  /* A probe sequence that reached this slot would have gone on
+     to the next one.  If that is empty, no sequence needs this
+     slot to stay in the way, so it can be empty too. */
+  found = h->slots[i];
+  if (h->ctrl[(i + 1) & (h->slot_cnt - 1)] == CTRL_EMPTY)
+    h->ctrl[i] = CTRL_EMPTY;
+  else
+    {
+      h->ctrl[i] = CTRL_DELETED;
+      h->deleted_cnt++;
+    }
+  h->elem_cnt--;
+
+  /* Shrink a map that has become mostly empty.  Failure only
+     wastes memory. */
+  if (h->slot_cnt > MIN_SLOTS && h->elem_cnt * 8 < h->slot_cnt)
+    resize (h, h->slot_cnt / 2);
+
+  return found;
+}
+
+/* Initializes I for iterating map H.
+
+   Iteration idiom:
+
+      struct hmap_iterator i;
+      struct hmap_elem *e;
+
+      hmap_first (&i, h);
+      while ((e = hmap_next (&i)) != NULL)
+        {
+          struct foo *f = hmap_entry (e, struct foo, elem);
+          ...do something with f...
+        }
+
+   Modifying map H during iteration, using any of the functions
+   hmap_clear(), hmap_destroy(), hmap_insert(), or hmap_delete(),
+   invalidates all iterators. */
+void
+hmap_first (struct hmap_iterator *i, struct hmap *h)
+{
+  ASSERT (i != NULL);
+  ASSERT (h != NULL);
+
+  i->map = h;
+  i->idx = 0;
+}
+
+/* Advances I to the next element in the map and returns it.
+   Returns a null pointer if no elements are left.  Elements are
+   returned in arbitrary order. */
+struct hmap_elem *
+hmap_next (struct hmap_iterator *i)
+{
+  struct hmap *h = i->map;
+
+  for (; i->idx < h->slot_cnt; i->idx++)
+    if (is_full (h->ctrl[i->idx]))
+      return h->slots[i->idx++];
+  return NULL;
+}
+
+/* Returns the number of elements in H. */
+size_t
+hmap_size (struct hmap *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+hmap_empty (struct hmap *h)
+{
+  return h->elem_cnt == 0;
+}
+
+/* Returns the number of slots in H.  Its load factor is
+   hmap_size() divided by this. */
+size_t
+hmap_capacity (struct hmap *h)
+{
+  return h->slot_cnt;
+}
+
+/* Returns the slot in H that holds an element equal to E, whose
+   hash value is HASH, or SIZE_MAX if there is none.  Only slots
+   whose metadata byte matches HASH are compared. */
+static size_t
+find_slot (struct hmap *h, struct hmap_elem *e, unsigned hash)
+{
+  size_t mask = h->slot_cnt - 1;
+  uint8_t ctrl = hash_ctrl (hash);
+  size_t i;
+
+  for (i = first_slot (hash, h->slot_cnt); h->ctrl[i] != CTRL_EMPTY;
+       i = (i + 1) & mask)
+    if (h->ctrl[i] == ctrl && h->slots[i]->hash == hash
+        && h->equal (h->slots[i], e, h->aux))
+      return i;
+  return SIZE_MAX;
+}
+
+/* Moves the elements of H into a new array of SLOT_CNT slots,
+   which must be a power of 2 with room for all of them, leaving
+   no deleted slots.  Elements are placed by their cached hash
+   values, without calling the hash function.
+   Returns true if successful, false if memory allocation failed,
+   in which case H is unchanged. */
+static bool
+resize (struct hmap *h, size_t slot_cnt)
+{
+  struct hmap_elem **old_slots = h->slots;
+  uint8_t *old_ctrl = h->ctrl;
+  size_t old_slot_cnt = h->slot_cnt;
+  size_t mask = slot_cnt - 1;
+  struct hmap_elem **slots;
+  uint8_t *ctrl;
+  size_t i;
+
+  ASSERT (slot_cnt > h->elem_cnt);
+  ASSERT ((slot_cnt & mask) == 0);
+
+  /* The metadata bytes follow the slots in the same block. */
+  slots = malloc (slot_cnt * (sizeof *slots + 1));
+  if (slots == NULL)
+    return false;
+  ctrl = (uint8_t *) (slots + slot_cnt);
+  memset (ctrl, CTRL_EMPTY, slot_cnt);
+
+  for (i = 0; i < old_slot_cnt; i++)
+    if (is_full (old_ctrl[i]))
+      {
+        struct hmap_elem *e = old_slots[i];
+        size_t j;
+
+        for (j = first_slot (e->hash, slot_cnt); ctrl[j] != CTRL_EMPTY;
+             j = (j + 1) & mask)
+          continue;
+        ctrl[j] = hash_ctrl (e->hash);
+        slots[j] = e;
+      }
+
+  h->slots = slots;
+  h->ctrl = ctrl;
+  h->slot_cnt = slot_cnt;
+  h->deleted_cnt = 0;
+  free (old_slots);
+  return true;
+}
@@ -0,0 +1,97 @@
+#ifndef __LIB_KERNEL_HMAP_H
+#define __LIB_KERNEL_HMAP_H
+
+/* Open-addressing hash map.
+
+   Like the hash table in hash.h, this is intrusive: each
+   structure that can be in a map embeds a struct hmap_elem, and
+   hmap_entry converts a pointer to the struct hmap_elem back to
+   a pointer to the structure.  The key is part of the structure
+   too, so an element is looked up by filling in the key of a
+   stack-allocated structure of the same type and passing its
+   struct hmap_elem, just as with hash_find().
+
+   Unlike the hash table, which chains elements in a list per
+   bucket, the map keeps pointers to its elements in a single
+   array of slots, alongside an array of one metadata byte per
+   slot.  A lookup starts at the slot given by the element's
+   hash value and probes the following slots in turn.  Each
+   metadata byte says whether its slot is empty, deleted or full,
+   and for a full slot holds 7 more bits of the hash value, so
+   almost every slot that does not match is passed over without
+   touching the element it points to.  The metadata bytes for a
+   whole probe sequence usually share a cache line. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Map element. */
+struct hmap_elem
+  {
+    unsigned hash;              /* Hash value, cached for resizing. */
+  };
+
+/* Converts pointer to map element HMAP_ELEM into a pointer to
+   the structure that HMAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the map element. */
+#define hmap_entry(HMAP_ELEM, STRUCT, MEMBER)                   \
+        ((STRUCT *) ((uint8_t *) &(HMAP_ELEM)->hash             \
+                     - offsetof (STRUCT, MEMBER.hash)))
+
+/* Computes and returns the hash value for map element E, given
+   auxiliary data AUX. */
+typedef unsigned hmap_hash_func (const struct hmap_elem *e, void *aux);
+
+/* Returns true if the keys of map elements A and B are equal,
+   given auxiliary data AUX. */
+typedef bool hmap_equal_func (const struct hmap_elem *a,
+                              const struct hmap_elem *b,
+                              void *aux);
+
+/* Performs some operation on map element E, given auxiliary
+   data AUX. */
+typedef void hmap_action_func (struct hmap_elem *e, void *aux);
+
+/* Hash map. */
+struct hmap
+  {
+    size_t elem_cnt;            /* Number of elements in map. */
+    size_t deleted_cnt;         /* Number of deleted slots. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    struct hmap_elem **slots;   /* Array of `slot_cnt' elements. */
+    uint8_t *ctrl;              /* Metadata byte for each slot. */
+    hmap_hash_func *hash;       /* Hash function. */
+    hmap_equal_func *equal;     /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `hash' and `equal'. */
+  };
+
+/* A map iterator. */
+struct hmap_iterator
+  {
+    struct hmap *map;           /* The map. */
+    size_t idx;                 /* Next slot to examine. */
+  };
+
+/* Basic life cycle. */
+bool hmap_init (struct hmap *, hmap_hash_func *, hmap_equal_func *,
+                void *aux);
+void hmap_clear (struct hmap *, hmap_action_func *);
+void hmap_destroy (struct hmap *, hmap_action_func *);
+
+/* Search, insertion, deletion. */
+struct hmap_elem *hmap_insert (struct hmap *, struct hmap_elem *);
+struct hmap_elem *hmap_find (struct hmap *, struct hmap_elem *);
+struct hmap_elem *hmap_delete (struct hmap *, struct hmap_elem *);
+
+/* Iteration. */
+void hmap_first (struct hmap_iterator *, struct hmap *);
+struct hmap_elem *hmap_next (struct hmap_iterator *);
+
+/* Information. */
+size_t hmap_size (struct hmap *);
+bool hmap_empty (struct hmap *);
+size_t hmap_capacity (struct hmap *);
+
+#endif /* lib/kernel/hmap.h */
@@ -0,0 +1,572 @@
+/* Radix tree.
+
+   See radix.h for basic information. */
+
+#include "radix.h"
+#include <limits.h>
+#include <round.h>
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Number of bits in an index, and the most levels a tree can
+   need to hold every index. */
+#define INDEX_BITS (sizeof (unsigned long) * CHAR_BIT)
+#define MAX_HEIGHT DIV_ROUND_UP (INDEX_BITS, RADIX_SHIFT)
+
+/* Index into a node's `masks' of the mask of slots that are in
+   use, after the RADIX_TAG_CNT masks of slots that lead to tagged
+   items. */
+#define PRESENT RADIX_TAG_CNT
+
+/* A node.  A node at height 1 is a leaf and its slots point to
+   items; a node at any greater height points to nodes one level
+   lower.  Bit I of masks[PRESENT] is set if slot I is non-null,
+   and bit I of masks[TAG] if slot I is, or leads to, an item with
+   tag TAG.  A uint32_t mask has room for every slot. */
+struct radix_node
+  {
+    uint32_t masks[RADIX_TAG_CNT + 1];  /* Slot masks. */
+    void *slots[RADIX_SLOTS];           /* Items or child nodes. */
+  };
+
+static bool grow (struct radix_tree *, unsigned long index);
+static void shrink (struct radix_tree *);
+static struct radix_node *descend (const struct radix_tree *,
+                                   unsigned long index,
+                                   struct radix_node *nodes[]);
+static void propagate (struct radix_tree *, struct radix_node *nodes[],
+                       unsigned long index, unsigned height);
+static void *find_next (const struct radix_tree *, unsigned long index,
+                        unsigned long last, int mask,
+                        unsigned long *found);
+static size_t gang_lookup (struct radix_tree *, unsigned long first,
+                           void **items, unsigned long *indexes,
+                           size_t max_cnt, int mask);
+static void destroy_node (struct radix_node *, unsigned height,
+                          unsigned long base, radix_action_func *);
+
+/* Returns a mask of the low BITS bits of an index. */
+static inline unsigned long
+low_bits (unsigned bits)
+{
+  return bits >= INDEX_BITS ? ULONG_MAX : (1UL << bits) - 1;
+}
+
+/* Returns the largest index that a tree of HEIGHT levels can
+   hold. */
+static inline unsigned long
+max_index (unsigned height)
+{
+  return low_bits (height * RADIX_SHIFT);
+}
+
+/* Returns the slot for INDEX in a node at HEIGHT. */
+static inline size_t
+slot_of (unsigned long index, unsigned height)
+{
+  return (index >> ((height - 1) * RADIX_SHIFT)) & (RADIX_SLOTS - 1);
+}
+
+/* Returns the index of the lowest 1 bit in X, which must not be
+   0. */
+static inline unsigned
+lowest_bit (uint32_t x)
+{
+  uint32_t bit;
+  asm ("bsfl %1, %0" : "=r" (bit) : "rm" (x) : "cc");
+  return bit;
+}
+
+/* Initializes T as an empty tree. */
+void
+radix_init (struct radix_tree *t)
+{
+  t->root = NULL;
+  t->height = 0;
+  t->size = 0;
+}
+
+/* Frees T's nodes, leaving it empty.
+
+   If DESTRUCTOR is non-null, then it is called for each item in
+   the tree, in index order.  DESTRUCTOR may deallocate the item,
+   but must not modify the tree. */
+void
+radix_destroy (struct radix_tree *t, radix_action_func *destructor)
+{
+  if (t->root != NULL)
+    destroy_node (t->root, t->height, 0, destructor);
+  radix_init (t);
+}
+
+/* Inserts ITEM, which must be non-null, into T at INDEX and
+   returns a null pointer, if no item is already at INDEX.
+   If an item is already at INDEX, returns it without inserting
+   ITEM.
+   If memory allocation fails, returns ITEM itself without
+   inserting it. */
+void *
+radix_insert (struct radix_tree *t, unsigned long index, void *item)
+{
+  struct radix_node *nodes[MAX_HEIGHT];
+  struct radix_node *node;
+  unsigned h;
+  size_t slot;
+
+  ASSERT (item != NULL);
+
+  if (!grow (t, index))
+    return item;
+
+  node = t->root;
+  for (h = t->height; h > 1; h--)
+    {
+      nodes[h - 1] = node;
+      slot = slot_of (index, h);
+      if (node->slots[slot] == NULL)
+        {
+          struct radix_node *child = calloc (1, sizeof *child);
+          if (child == NULL)
+            {
+              /* Free any nodes we added on the way down. */
+              propagate (t, nodes, index, h);
+              return item;
+            }
+          node->slots[slot] = child;
+          node->masks[PRESENT] |= 1u << slot;
+        }
+      node = node->slots[slot];
+    }
+
+  slot = slot_of (index, 1);
+  if (node->slots[slot] != NULL)
+    return node->slots[slot];
+  node->slots[slot] = item;
+  node->masks[PRESENT] |= 1u << slot;
+  t->size++;
+  return NULL;
+}
+
+/* Returns the item at INDEX in T, or a null pointer if there is
+   none. */
+void *
+radix_lookup (struct radix_tree *t, unsigned long index)
+{
+  struct radix_node *leaf = descend (t, index, NULL);
+  return leaf != NULL ? leaf->slots[slot_of (index, 1)] : NULL;
+}
+
+/* Removes and returns the item at INDEX in T, or returns a null
+   pointer if there is none.  Frees any nodes left empty. */
+void *
+radix_delete (struct radix_tree *t, unsigned long index)
+{
+  struct radix_node *nodes[MAX_HEIGHT];
+  struct radix_node *leaf = descend (t, index, nodes);
+  size_t slot = slot_of (index, 1);
+  void *item;
+  int i;
+
+  if (leaf == NULL || leaf->slots[slot] == NULL)
+    return NULL;
+
+  item = leaf->slots[slot];
+  leaf->slots[slot] = NULL;
+  for (i = 0; i <= PRESENT; i++)
+    leaf->masks[i] &= ~(1u << slot);
+  t->size--;
+
+  propagate (t, nodes, index, 1);
+  return item;
+}
+
+/* Stores into ITEMS up to MAX_CNT of the items in T, in order of
+   index, starting from the first at FIRST or greater.  If
+   INDEXES is non-null, stores their indexes into it too.
+   Returns the number of items stored. */
+size_t
+radix_gang_lookup (struct radix_tree *t, unsigned long first,
+                   void **items, unsigned long *indexes, size_t max_cnt)
+{
+  return gang_lookup (t, first, items, indexes, max_cnt, PRESENT);
+}
+
+/* Sets TAG on the item at INDEX in T and returns the item, or
+   returns a null pointer if there is none. */
+void *
+radix_tag_set (struct radix_tree *t, unsigned long index, enum radix_tag tag)
+{
+  struct radix_node *nodes[MAX_HEIGHT];
+  struct radix_node *leaf = descend (t, index, nodes);
+  size_t slot = slot_of (index, 1);
+
+  ASSERT (tag < RADIX_TAG_CNT);
+
+  if (leaf == NULL || leaf->slots[slot] == NULL)
+    return NULL;
+  leaf->masks[tag] |= 1u << slot;
+  propagate (t, nodes, index, 1);
+  return leaf->slots[slot];
+}
+
+/* Clears TAG on the item at INDEX in T and returns the item, or
+   returns a null pointer if there is none. */
+void *
+radix_tag_clear (struct radix_tree *t, unsigned long index,
+                 enum radix_tag tag)
+{
+  struct radix_node *nodes[MAX_HEIGHT];
+  struct radix_node *leaf = descend (t, index, nodes);
+  size_t slot = slot_of (index, 1);
+
+  ASSERT (tag < RADIX_TAG_CNT);
+
+  if (leaf == NULL || leaf->slots[slot] == NULL)
+    return NULL;
+  leaf->masks[tag] &= ~(1u << slot);
+  propagate (t, nodes, index, 1);
+  return leaf->slots[slot];
+}
+
+/* Returns true if there is an item at INDEX in T with TAG set,
+   false otherwise. */
+bool
+radix_tag_get (struct radix_tree *t, unsigned long index, enum radix_tag tag)
+{
+  struct radix_node *leaf = descend (t, index, NULL);
+
+  ASSERT (tag < RADIX_TAG_CNT);
+
+  return leaf != NULL && (leaf->masks[tag] & (1u << slot_of (index, 1)));
+}
+
+/* Returns true if any item in T has TAG set, false otherwise. */
+bool
+radix_tagged (struct radix_tree *t, enum radix_tag tag)
+{
+  ASSERT (tag < RADIX_TAG_CNT);
+
+  return t->root != NULL && t->root->masks[tag] != 0;
+}
+
+/* Like radix_gang_lookup(), but stores only items with TAG
+   set. */
+size_t
+radix_gang_lookup_tag (struct radix_tree *t, unsigned long first,
+                       void **items, unsigned long *indexes,
+                       size_t max_cnt, enum radix_tag tag)
+{
+  ASSERT (tag < RADIX_TAG_CNT);
+
+  return gang_lookup (t, first, items, indexes, max_cnt, tag);
+}
+
+/* Initializes I for iterating over the items in T at indexes
+   FIRST through LAST, inclusive, in order of index.
+
+   Iteration idiom:
+
+      struct radix_iterator i;
+      void *item;
+
+      radix_first (&i, t, first, last);
+      while ((item = radix_next (&i)) != NULL)
+        {
+          ...do something with item, at index i.index...
+        }
+
+   The item that radix_next() last returned may be deleted, but
+   inserting into or deleting from the tree anywhere else during
+   iteration may cause items to be skipped or visited after
+   their deletion. */
+void
+radix_first (struct radix_iterator *i, struct radix_tree *t,
+             unsigned long first, unsigned long last)
+{
+  ASSERT (i != NULL);
+  ASSERT (t != NULL);
+
+  i->tree = t;
+  i->index = first;
+  i->last = last;
+  i->tag = -1;
+  i->started = false;
+}
+
+/* Like radix_first(), but I will visit only items with TAG
+   set. */
+void
+radix_first_tag (struct radix_iterator *i, struct radix_tree *t,
+                 unsigned long first, unsigned long last,
+                 enum radix_tag tag)
+{
+  ASSERT (tag < RADIX_TAG_CNT);
+
+  radix_first (i, t, first, last);
+  i->tag = tag;
+}
+
+/* Advances I to the next item in its range and returns it, with
+   its index in I->index.  Returns a null pointer if no items are
+   left. */
+void *
+radix_next (struct radix_iterator *i)
+{
+  unsigned long start = i->index;
+  void *item;
+
+  if (i->started)
+    {
+      if (start >= i->last)
+        return NULL;
+      start++;
+    }
+  i->started = true;
+
+  item = find_next (i->tree, start, i->last,
+                    i->tag >= 0 ? i->tag : PRESENT, &i->index);
+  if (item == NULL)
+    i->index = i->last;
+  return item;
+}
+
+/* Returns the number of items in T. */
+size_t
+radix_size (struct radix_tree *t)
+{
+  return t->size;
+}
+
+/* Returns true if T contains no items, false otherwise. */
+bool
+radix_empty (struct radix_tree *t)
+{
+  return t->size == 0;
+}
+
+/* Adds levels to the top of T until it can hold INDEX.
+   Returns true if successful, false if memory allocation
+   failed, in which case T is unchanged. */
+static bool
+grow (struct radix_tree *t, unsigned long index)
+{
+  if (t->root == NULL)
+    {
+      /* An empty tree starts out as tall as INDEX needs. */
+      t->root = calloc (1, sizeof *t->root);
+      if (t->root == NULL)
+        return false;
+      for (t->height = 1; index > max_index (t->height); t->height++)
+        continue;
+      return true;
+    }
+
+  while (index > max_index (t->height))
+    {
+      struct radix_node *root = calloc (1, sizeof *root);
+      int i;
+
+      if (root == NULL)
+        {
+          shrink (t);
+          return false;
+        }
+
+      /* The old root covers the lowest indexes of the new. */
+      root->slots[0] = t->root;
+      for (i = 0; i <= PRESENT; i++)
+        if (t->root->masks[i] != 0)
+          root->masks[i] = 1;
+      t->root = root;
+      t->height++;
+    }
+  return true;
+}
+
+/* Removes levels from the top of T that are not needed for the
+   items it holds, and frees an empty root. */
+static void
+shrink (struct radix_tree *t)
+{
+  while (t->root != NULL)
+    {
+      struct radix_node *root = t->root;
+
+      if (root->masks[PRESENT] == 0)
+        {
+          t->root = NULL;
+          t->height = 0;
+        }
+      else if (t->height > 1 && root->masks[PRESENT] == 1)
+        {
+          t->root = root->slots[0];
+          t->height--;
+        }
+      else
+        break;
+      free (root);
+    }
+}
+
+/* Returns the leaf node that would hold INDEX in T, or a null
+   pointer if there is none.  If NODES is non-null, stores the
+   node at each height H on the way down into NODES[H - 1]. */
+static struct radix_node *
+descend (const struct radix_tree *t, unsigned long index,
+         struct radix_node *nodes[])
+{
+  struct radix_node *node = t->root;
+  unsigned h;
+
+  if (node == NULL || index > max_index (t->height))
+    return NULL;
+
+  for (h = t->height; h > 1; h--)
+    {
+      if (nodes != NULL)
+        nodes[h - 1] = node;
+      node = node->slots[slot_of (index, h)];
+      if (node == NULL)
+        return NULL;
+    }
+  if (nodes != NULL)
+    nodes[0] = node;
+  return node;
+}
+
+/* Brings the masks of the nodes above HEIGHT on the path to
+   INDEX in T, which are in NODES as stored by descend(), up to
+   date with the node at HEIGHT, and frees any nodes left empty. */
+static void
+propagate (struct radix_tree *t, struct radix_node *nodes[],
+           unsigned long index, unsigned height)
+{
+  unsigned h;
+  int i;
+
+  for (h = height; h < t->height; h++)
+    {
+      struct radix_node *child = nodes[h - 1];
+      struct radix_node *parent = nodes[h];
+      size_t slot = slot_of (index, h + 1);
+      uint32_t bit = 1u << slot;
+
+      if (child->masks[PRESENT] == 0)
+        {
+          parent->slots[slot] = NULL;
+          for (i = 0; i <= PRESENT; i++)
+            parent->masks[i] &= ~bit;
+          free (child);
+        }
+      else
+        for (i = 0; i < RADIX_TAG_CNT; i++)
+          if (child->masks[i] != 0)
+            parent->masks[i] |= bit;
+          else
+            parent->masks[i] &= ~bit;
+    }
+  shrink (t);
+}
+
+/* Returns the first item in T at an index from INDEX to LAST,
+   inclusive, whose slot is in mask MASK of its leaf node, and
+   stores its index in *FOUND.  Returns a null pointer if there
+   is none. */
+static void *
+find_next (const struct radix_tree *t, unsigned long index,
+           unsigned long last, int mask, unsigned long *found)
+{
+  struct radix_node *node;
+  unsigned h;
+
+ restart:
+  if (t->root == NULL || index > last || index > max_index (t->height))
+    return NULL;
+
+  node = t->root;
+  for (h = t->height; ; h--)
+    {
+      unsigned shift = (h - 1) * RADIX_SHIFT;
+      size_t slot = slot_of (index, h);
+      uint32_t bits = node->masks[mask] >> slot;
+
+      if (bits == 0)
+        {
+          /* Nothing at or after INDEX in this node.  Skip to the
+             start of the next node at this height and try again
+             from the root.  Each node's masks say exactly what is
+             below it, so this happens at most once per level of
+             the tree. */
+          unsigned long next = (index | low_bits (shift + RADIX_SHIFT)) + 1;
+          if (next == 0)
+            return NULL;
+          index = next;
+          goto restart;
+        }
+      if ((bits & 1) == 0)
+        {
+          /* Skip to the start of the next slot in use. */
+          slot += lowest_bit (bits);
+          index = ((index & ~low_bits (shift + RADIX_SHIFT))
+                   | ((unsigned long) slot << shift));
+          if (index > last)
+            return NULL;
+        }
+
+      if (h == 1)
+        {
+          *found = index;
+          return node->slots[slot];
+        }
+      node = node->slots[slot];
+    }
+}
+
+/* Implements radix_gang_lookup() and radix_gang_lookup_tag(),
+   storing items in mask MASK of their leaf nodes. */
+static size_t
+gang_lookup (struct radix_tree *t, unsigned long first,
+             void **items, unsigned long *indexes, size_t max_cnt, int mask)
+{
+  unsigned long index = first;
+  size_t cnt = 0;
+
+  while (cnt < max_cnt)
+    {
+      void *item = find_next (t, index, ULONG_MAX, mask, &index);
+      if (item == NULL)
+        break;
+      items[cnt] = item;
+      if (indexes != NULL)
+        indexes[cnt] = index;
+      cnt++;
+      if (index == ULONG_MAX)
+        break;
+      index++;
+    }
+  return cnt;
+}
+
+/* Frees NODE, at HEIGHT, and all the nodes below it, calling
+   DESTRUCTOR, if non-null, for each item, whose indexes start
+   at BASE. */
+static void
+destroy_node (struct radix_node *node, unsigned height, unsigned long base,
+              radix_action_func *destructor)
+{
+  unsigned shift = (height - 1) * RADIX_SHIFT;
+  uint32_t present = node->masks[PRESENT];
+
+  while (present != 0)
+    {
+      size_t slot = lowest_bit (present);
+      unsigned long index = base | ((unsigned long) slot << shift);
+
+      present &= present - 1;
+      if (height > 1)
+        destroy_node (node->slots[slot], height - 1, index, destructor);
+      else if (destructor != NULL)
+        destructor (index, node->slots[slot]);
+    }
+  free (node);
+}
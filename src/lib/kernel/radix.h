@@ -0,0 +1,103 @@
+#ifndef __LIB_KERNEL_RADIX_H
+#define __LIB_KERNEL_RADIX_H
+
+/* Radix tree.
+
+   Maps unsigned long indexes, such as page numbers within a file
+   or within a process's address space, to non-null pointers.
+   Each node of the tree has RADIX_SLOTS slots and consumes
+   RADIX_SHIFT bits of the index, most significant first, so a
+   lookup costs one step per level and the tree is only as tall
+   as its largest index needs.  Indexes near each other share
+   nodes, which suits the dense runs of pages that files and
+   address spaces are made of.
+
+   Unlike a hash table, the tree keeps its items in index order,
+   so radix_gang_lookup() and the iterator can visit the items in
+   a range of indexes, as truncating a file or unmapping a region
+   needs, without looking at every index in the range.
+
+   Each item may also carry any of RADIX_TAG_CNT tags, such as
+   RADIX_TAG_DIRTY and RADIX_TAG_WRITEBACK for cached pages.
+   Every node records which of its slots lead to a tagged item,
+   so the tagged items can be found without visiting the rest.
+
+   Unlike the other containers in lib/kernel, the tree is not
+   intrusive: it allocates its own nodes with malloc(), and so
+   insertion can fail.  The tree does no locking. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of index bits consumed by each level of the tree, and
+   the number of slots in each node. */
+#define RADIX_SHIFT 5
+#define RADIX_SLOTS (1 << RADIX_SHIFT)
+
+/* Item tags. */
+enum radix_tag
+  {
+    RADIX_TAG_DIRTY,            /* Modified since last written back. */
+    RADIX_TAG_WRITEBACK,        /* Being written back. */
+    RADIX_TAG_CNT               /* Number of tags. */
+  };
+
+/* Radix tree. */
+struct radix_tree
+  {
+    struct radix_node *root;    /* Root node, or null if empty. */
+    unsigned height;            /* Levels of nodes, 0 if empty. */
+    size_t size;                /* Number of items. */
+  };
+
+/* Iterator over the items in a range of indexes. */
+struct radix_iterator
+  {
+    struct radix_tree *tree;    /* The tree. */
+    unsigned long index;        /* Index of current item. */
+    unsigned long last;         /* Last index in the range. */
+    int tag;                    /* Tag to match, or -1 for any item. */
+    bool started;               /* Has radix_next() been called? */
+  };
+
+/* Performs some operation on ITEM, at INDEX in a tree. */
+typedef void radix_action_func (unsigned long index, void *item);
+
+/* Basic life cycle. */
+void radix_init (struct radix_tree *);
+void radix_destroy (struct radix_tree *, radix_action_func *);
+
+/* Search, insertion, deletion. */
+void *radix_insert (struct radix_tree *, unsigned long index, void *item);
+void *radix_lookup (struct radix_tree *, unsigned long index);
+void *radix_delete (struct radix_tree *, unsigned long index);
+size_t radix_gang_lookup (struct radix_tree *, unsigned long first,
+                          void **items, unsigned long *indexes,
+                          size_t max_cnt);
+
+/* Tags. */
+void *radix_tag_set (struct radix_tree *, unsigned long index,
+                     enum radix_tag);
+void *radix_tag_clear (struct radix_tree *, unsigned long index,
+                       enum radix_tag);
+bool radix_tag_get (struct radix_tree *, unsigned long index,
+                    enum radix_tag);
+bool radix_tagged (struct radix_tree *, enum radix_tag);
+size_t radix_gang_lookup_tag (struct radix_tree *, unsigned long first,
+                              void **items, unsigned long *indexes,
+                              size_t max_cnt, enum radix_tag);
+
+/* Iteration over ranges. */
+void radix_first (struct radix_iterator *, struct radix_tree *,
+                  unsigned long first, unsigned long last);
+void radix_first_tag (struct radix_iterator *, struct radix_tree *,
+                      unsigned long first, unsigned long last,
+                      enum radix_tag);
+void *radix_next (struct radix_iterator *);
+
+/* Information. */
+size_t radix_size (struct radix_tree *);
+bool radix_empty (struct radix_tree *);
+
+#endif /* lib/kernel/radix.h */
@@ -0,0 +1,418 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* Red-black tree, after the algorithms in chapter 13 of Cormen,
+   Leiserson, Rivest and Stein, "Introduction to Algorithms",
+   with null pointers in place of the sentinel leaf.
+
+   Every node is red or black, the root is black, a red node's
+   children are black, and every path from a node down to a null
+   child passes through the same number of black nodes.  So no
+   path from the root is more than twice as long as any other,
+   and the tree's height is O(log n). */
+
+static void rotate_left (struct rb_tree *, struct rb_node *);
+static void rotate_right (struct rb_tree *, struct rb_node *);
+static void insert_fixup (struct rb_tree *, struct rb_node *);
+static void remove_fixup (struct rb_tree *, struct rb_node *,
+                          struct rb_node *parent);
+static void transplant (struct rb_tree *, struct rb_node *,
+                        struct rb_node *);
+static struct rb_node *subtree_min (struct rb_node *);
+static struct rb_node *subtree_max (struct rb_node *);
+
+/* Returns true if node N is red.  Null children are black. */
+static inline bool
+is_red (const struct rb_node *n)
+{
+  return n != NULL && n->red;
+}
+
+/* Initializes T as an empty tree that orders its nodes using
+   LESS, given auxiliary data AUX. */
+void
+rb_init (struct rb_tree *t, rb_less_func *less, void *aux)
+{
+  ASSERT (t != NULL);
+  ASSERT (less != NULL);
+
+  t->root = NULL;
+  t->size = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/* Inserts NODE into T, after any nodes equal to it. */
+void
+rb_insert (struct rb_tree *t, struct rb_node *node)
+{
+  struct rb_node **link = &t->root;
+  struct rb_node *parent = NULL;
+
+  ASSERT (node != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      link = (t->less (node, parent, t->aux)
+              ? &parent->left : &parent->right);
+    }
+  node->parent = parent;
+  node->left = node->right = NULL;
+  node->red = true;
+  *link = node;
+  t->size++;
+
+  insert_fixup (t, node);
+}
+
+/* Removes NODE, which must be in T, from T. */
+void
+rb_remove (struct rb_tree *t, struct rb_node *node)
+{
+  struct rb_node *child, *parent;
+  bool removed_red;
+
+  ASSERT (node != NULL);
+  ASSERT (t->size > 0);
+
+  if (node->left == NULL || node->right == NULL)
+    {
+      /* NODE has at most one child, which takes its place. */
+      child = node->left != NULL ? node->left : node->right;
+      parent = node->parent;
+      removed_red = node->red;
+      transplant (t, node, child);
+    }
+  else
+    {
+      /* NODE's successor, which has no left child, takes its
+         place, and the successor's right child takes the
+         successor's. */
+      struct rb_node *next = subtree_min (node->right);
+
+      removed_red = next->red;
+      child = next->right;
+      if (next->parent == node)
+        parent = next;
+      else
+        {
+          parent = next->parent;
+          transplant (t, next, next->right);
+          next->right = node->right;
+          next->right->parent = next;
+        }
+      transplant (t, node, next);
+      next->left = node->left;
+      next->left->parent = next;
+      next->red = node->red;
+    }
+  t->size--;
+
+  if (!removed_red)
+    remove_fixup (t, child, parent);
+}
+
+/* Returns the first node in T equal to KEY, or a null pointer if
+   there is none. */
+struct rb_node *
+rb_find (struct rb_tree *t, const struct rb_node *key)
+{
+  struct rb_node *n = rb_lower_bound (t, key);
+  return n != NULL && !t->less (key, n, t->aux) ? n : NULL;
+}
+
+/* Returns the first node in T that is not less than KEY, or a
+   null pointer if every node is less than KEY. */
+struct rb_node *
+rb_lower_bound (struct rb_tree *t, const struct rb_node *key)
+{
+  struct rb_node *n = t->root;
+  struct rb_node *found = NULL;
+
+  while (n != NULL)
+    if (t->less (n, key, t->aux))
+      n = n->right;
+    else
+      {
+        found = n;
+        n = n->left;
+      }
+  return found;
+}
+
+/* Returns the least node in T, or a null pointer if T is
+   empty. */
+struct rb_node *
+rb_min (struct rb_tree *t)
+{
+  return t->root != NULL ? subtree_min (t->root) : NULL;
+}
+
+/* Returns the greatest node in T, or a null pointer if T is
+   empty. */
+struct rb_node *
+rb_max (struct rb_tree *t)
+{
+  return t->root != NULL ? subtree_max (t->root) : NULL;
+}
+
+/* Returns the node that follows N in its tree, or a null pointer
+   if N is the greatest. */
+struct rb_node *
+rb_next (struct rb_node *n)
+{
+  ASSERT (n != NULL);
+
+  if (n->right != NULL)
+    return subtree_min (n->right);
+  while (n->parent != NULL && n == n->parent->right)
+    n = n->parent;
+  return n->parent;
+}
+
+/* Returns the node that precedes N in its tree, or a null
+   pointer if N is the least. */
+struct rb_node *
+rb_prev (struct rb_node *n)
+{
+  ASSERT (n != NULL);
+
+  if (n->left != NULL)
+    return subtree_max (n->left);
+  while (n->parent != NULL && n == n->parent->left)
+    n = n->parent;
+  return n->parent;
+}
+
+/* Returns the number of nodes in T. */
+size_t
+rb_size (struct rb_tree *t)
+{
+  return t->size;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty (struct rb_tree *t)
+{
+  return t->root == NULL;
+}
+
+/* Restores the red-black properties after inserting red node N,
+   whose parent may also be red. */
+static void
+insert_fixup (struct rb_tree *t, struct rb_node *n)
+{
+  struct rb_node *parent;
+
+  while (is_red (parent = n->parent))
+    {
+      /* A red parent is not the root, so it has a parent. */
+      struct rb_node *grandparent = parent->parent;
+
+      if (parent == grandparent->left)
+        {
+          struct rb_node *uncle = grandparent->right;
+
+          if (is_red (uncle))
+            {
+              /* Push the grandparent's blackness down and carry
+                 on from the grandparent. */
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              n = grandparent;
+            }
+          else
+            {
+              /* Rotate N into line with its parent, if it isn't,
+                 then rotate the parent up. */
+              if (n == parent->right)
+                {
+                  rotate_left (t, parent);
+                  n = parent;
+                  parent = n->parent;
+                }
+              parent->red = false;
+              grandparent->red = true;
+              rotate_right (t, grandparent);
+            }
+        }
+      else
+        {
+          struct rb_node *uncle = grandparent->left;
+
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              n = grandparent;
+            }
+          else
+            {
+              if (n == parent->left)
+                {
+                  rotate_right (t, parent);
+                  n = parent;
+                  parent = n->parent;
+                }
+              parent->red = false;
+              grandparent->red = true;
+              rotate_left (t, grandparent);
+            }
+        }
+    }
+  t->root->red = false;
+}
+
+/* Restores the red-black properties after removing a black node,
+   which left N, possibly null, as the child of PARENT with one
+   black node too few on its paths. */
+static void
+remove_fixup (struct rb_tree *t, struct rb_node *n, struct rb_node *parent)
+{
+  while (n != t->root && !is_red (n))
+    {
+      /* N's sibling has a black node more than N on its paths,
+         so it is not null. */
+      if (n == parent->left)
+        {
+          struct rb_node *sibling = parent->right;
+
+          if (sibling->red)
+            {
+              /* Make the sibling black. */
+              sibling->red = false;
+              parent->red = true;
+              rotate_left (t, parent);
+              sibling = parent->right;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              /* Take a black node off the sibling's paths too and
+                 carry on from the parent. */
+              sibling->red = true;
+              n = parent;
+              parent = n->parent;
+            }
+          else
+            {
+              /* Rotate a red nephew up to make good the missing
+                 black node. */
+              if (!is_red (sibling->right))
+                {
+                  sibling->left->red = false;
+                  sibling->red = true;
+                  rotate_right (t, sibling);
+                  sibling = parent->right;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->right->red = false;
+              rotate_left (t, parent);
+              n = t->root;
+            }
+        }
+      else
+        {
+          struct rb_node *sibling = parent->left;
+
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_right (t, parent);
+              sibling = parent->left;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              n = parent;
+              parent = n->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->left))
+                {
+                  sibling->right->red = false;
+                  sibling->red = true;
+                  rotate_left (t, sibling);
+                  sibling = parent->left;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->left->red = false;
+              rotate_right (t, parent);
+              n = t->root;
+            }
+        }
+    }
+  if (n != NULL)
+    n->red = false;
+}
+
+/* Makes N's right child take N's place in T, with N as its left
+   child. */
+static void
+rotate_left (struct rb_tree *t, struct rb_node *n)
+{
+  struct rb_node *r = n->right;
+
+  n->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = n;
+  transplant (t, n, r);
+  r->left = n;
+  n->parent = r;
+}
+
+/* Makes N's left child take N's place in T, with N as its right
+   child. */
+static void
+rotate_right (struct rb_tree *t, struct rb_node *n)
+{
+  struct rb_node *l = n->left;
+
+  n->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = n;
+  transplant (t, n, l);
+  l->right = n;
+  n->parent = l;
+}
+
+/* Puts NEW, which may be null, in OLD's place as a child of
+   OLD's parent or as the root of T.  OLD's own links are left
+   alone. */
+static void
+transplant (struct rb_tree *t, struct rb_node *old, struct rb_node *new)
+{
+  struct rb_node *parent = old->parent;
+
+  if (parent == NULL)
+    t->root = new;
+  else if (old == parent->left)
+    parent->left = new;
+  else
+    parent->right = new;
+  if (new != NULL)
+    new->parent = parent;
+}
+
+/* Returns the least node in the subtree rooted at N. */
+static struct rb_node *
+subtree_min (struct rb_node *n)
+{
+  while (n->left != NULL)
+    n = n->left;
+  return n;
+}
+
+/* Returns the greatest node in the subtree rooted at N. */
+static struct rb_node *
+subtree_max (struct rb_node *n)
+{
+  while (n->right != NULL)
+    n = n->right;
+  return n;
+}
@@ -0,0 +1,107 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A balanced binary search tree, which keeps its elements in
+   order and finds, inserts and removes any of them in O(log n)
+   time, for queues that a list would have to search in O(n)
+   time with list_insert_ordered() or list_max().
+
+   Like a list, the tree does not use dynamic allocation.  Each
+   structure that can be in a tree embeds a struct rb_node
+   member, and rb_entry converts a pointer to that member back to
+   a pointer to the structure, just as list_entry does.  For
+   example:
+
+      struct foo
+        {
+          struct rb_node node;
+          int64_t key;
+          ...other members...
+        };
+
+      static bool
+      foo_less (const struct rb_node *a, const struct rb_node *b,
+                void *aux UNUSED)
+      {
+        return (rb_entry (a, struct foo, node)->key
+                < rb_entry (b, struct foo, node)->key);
+      }
+
+      struct rb_tree foo_tree;
+      struct rb_node *n;
+
+      rb_init (&foo_tree, foo_less, NULL);
+      ...rb_insert (&foo_tree, &f->node)...
+      for (n = rb_min (&foo_tree); n != NULL; n = rb_next (n))
+        {
+          struct foo *f = rb_entry (n, struct foo, node);
+          ...do something with f...
+        }
+
+   Equal elements may be in a tree together.  A new element goes
+   after any that are equal to it, so that elements with equal
+   keys come out in the order they went in.
+
+   The tree does no locking and no type checking.  A node must
+   not be in more than one tree at a time. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree node. */
+struct rb_node
+  {
+    struct rb_node *parent;     /* Parent, or null at the root. */
+    struct rb_node *left;       /* Lesser subtree, or null. */
+    struct rb_node *right;      /* Greater or equal subtree, or null. */
+    bool red;                   /* Red if true, black if false. */
+  };
+
+/* Converts pointer to tree node RB_NODE into a pointer to the
+   structure that RB_NODE is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree node. */
+#define rb_entry(RB_NODE, STRUCT, MEMBER)                       \
+        ((STRUCT *) ((uint8_t *) &(RB_NODE)->parent             \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree nodes A and B, given auxiliary
+   data AUX.  Returns true if A is less than B, or false if A is
+   greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_node *a,
+                           const struct rb_node *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rb_tree
+  {
+    struct rb_node *root;       /* Root node, or null if empty. */
+    size_t size;                /* Number of nodes. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rb_init (struct rb_tree *, rb_less_func *, void *aux);
+
+/* Insertion and removal. */
+void rb_insert (struct rb_tree *, struct rb_node *);
+void rb_remove (struct rb_tree *, struct rb_node *);
+
+/* Search. */
+struct rb_node *rb_find (struct rb_tree *, const struct rb_node *);
+struct rb_node *rb_lower_bound (struct rb_tree *, const struct rb_node *);
+
+/* Traversal in order. */
+struct rb_node *rb_min (struct rb_tree *);
+struct rb_node *rb_max (struct rb_tree *);
+struct rb_node *rb_next (struct rb_node *);
+struct rb_node *rb_prev (struct rb_node *);
+
+/* Properties. */
+size_t rb_size (struct rb_tree *);
+bool rb_empty (struct rb_tree *);
+
+#endif /* lib/kernel/rbtree.h */
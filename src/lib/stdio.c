@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <round.h>
 #include <stdint.h>
 #include <string.h>
@@ -130,15 +131,30 @@ struct printf_conversion
 struct integer_base 
   {
     int base;                   /* Base. */
+    int shift;                  /* log2(base), or 0 if not a power of 2. */
     const char *digits;         /* Collection of digits. */
     int x;                      /* `x' character to use, for base 16 only. */
     int group;                  /* Number of digits to group with ' flag. */
   };
 
-static const struct integer_base base_d = {10, "0123456789", 0, 3};
-static const struct integer_base base_o = {8, "01234567", 0, 3};
-static const struct integer_base base_x = {16, "0123456789abcdef", 'x', 4};
-static const struct integer_base base_X = {16, "0123456789ABCDEF", 'X', 4};
+static const struct integer_base base_d = {10, 0, "0123456789", 0, 3};
+static const struct integer_base base_o = {8, 3, "01234567", 0, 3};
+static const struct integer_base base_x = {16, 4, "0123456789abcdef", 'x', 4};
+static const struct integer_base base_X = {16, 4, "0123456789ABCDEF", 'X', 4};
+
+/* The decimal numbers 00 through 99, two digits each, so that
+   format_integer() can convert two digits per division. */
+static const char digit_pairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
 
 static const char *parse_conversion (const char *format,
                                      struct printf_conversion *,
@@ -503,13 +519,55 @@ format_integer (uintmax_t value, bool is_signed, bool negative,
      will output the buffer's content in reverse. */
   cp = buf;
   digit_cnt = 0;
-  while (value > 0) 
+  if (c->flags & GROUP)
     {
-      if ((c->flags & GROUP) && digit_cnt > 0 && digit_cnt % b->group == 0)
-        *cp++ = ',';
-      *cp++ = b->digits[value % b->base];
-      value /= b->base;
-      digit_cnt++;
+      while (value > 0) 
+        {
+          if (digit_cnt > 0 && digit_cnt % b->group == 0)
+            *cp++ = ',';
+          *cp++ = b->digits[value % b->base];
+          value /= b->base;
+          digit_cnt++;
+        }
+    }
+  else if (b->shift != 0)
+    {
+      /* Shift and mask instead of dividing. */
+      while (value > 0) 
+        {
+          *cp++ = b->digits[value & (b->base - 1)];
+          value >>= b->shift;
+        }
+    }
+  else
+    {
+      /* Decimal.  Convert two digits per division, and switch to
+         32-bit division, which needs no call to __udivdi3(), as
+         soon as the value fits. */
+      unsigned long v;
+
+      ASSERT (b->base == 10);
+      while (value > ULONG_MAX) 
+        {
+          uintmax_t q = value / 100;
+          const char *pair = &digit_pairs[(value - q * 100) * 2];
+          *cp++ = pair[1];
+          *cp++ = pair[0];
+          value = q;
+        }
+      for (v = value; v >= 100; v /= 100) 
+        {
+          const char *pair = &digit_pairs[v % 100 * 2];
+          *cp++ = pair[1];
+          *cp++ = pair[0];
+        }
+      if (v >= 10)
+        {
+          *cp++ = digit_pairs[v * 2 + 1];
+          *cp++ = digit_pairs[v * 2];
+        }
+      else if (v > 0)
+        *cp++ = '0' + v;
     }
 
   /* Append enough zeros to match precision.
@@ -1,5 +1,28 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* Set by the kernel, once it has turned on SSE on a CPU that
+   has SSE2, to let memcpy() and memset() use it for large
+   blocks.  Never set in user programs.  This is not in the BSS,
+   because the kernel clears the BSS with memset(). */
+bool string_sse2 __attribute__ ((section (".data")));
+
+/* Blocks shorter than WORD_MIN bytes are copied or set a byte at
+   a time.  Blocks of at least SSE2_MIN bytes use SSE2, if
+   string_sse2 is true, with interrupts turned back on at least
+   every SSE2_CHUNK bytes. */
+#define WORD_MIN 16
+#define SSE2_MIN 1024
+#define SSE2_CHUNK 4096
+
+/* A 32-bit word that may alias any other type. */
+typedef uint32_t word_t __attribute__ ((may_alias));
+
+static void copy_forward (unsigned char *, const unsigned char *, size_t);
+static void copy_sse2 (unsigned char *, const unsigned char *, size_t);
+static void set_forward (unsigned char *, unsigned char, size_t);
+static void set_sse2 (unsigned char *, unsigned char, size_t);
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,8 +35,10 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
+  if (string_sse2 && size >= SSE2_MIN)
+    copy_sse2 (dst, src, size);
+  else
+    copy_forward (dst, src, size);
 
   return dst_;
 }
@@ -31,18 +56,28 @@ memmove (void *dst_, const void *src_, size_t size)
 
   if (dst < src) 
     {
-      while (size-- > 0)
-        *dst++ = *src++;
+      /* Copying upward never overwrites bytes of SRC that are
+         still to be read, even a word or 64 bytes at a time. */
+      if (string_sse2 && size >= SSE2_MIN)
+        copy_sse2 (dst, src, size);
+      else
+        copy_forward (dst, src, size);
     }
   else 
     {
       dst += size;
       src += size;
+      for (; size >= 4; size -= 4)
+        {
+          dst -= 4;
+          src -= 4;
+          *(word_t *) dst = *(const word_t *) src;
+        }
       while (size-- > 0)
         *--dst = *--src;
     }
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +93,10 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip equal words, then find the differing byte. */
+  for (; size >= 4; size -= 4, a += 4, b += 4)
+    if (*(const word_t *) a != *(const word_t *) b)
+      break;
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -281,9 +320,11 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
-  
-  while (size-- > 0)
-    *dst++ = value;
+
+  if (string_sse2 && size >= SSE2_MIN)
+    set_sse2 (dst, value, size);
+  else
+    set_forward (dst, value, size);
 
   return dst_;
 }
@@ -373,3 +414,123 @@ strlcat (char *dst, const char *src, size_t size)
   return src_len + dst_len;
 }
 
+
+/* Copies SIZE bytes upward from SRC to DST, a word at a time
+   with "rep movsl" once DST is word-aligned. */
+static void
+copy_forward (unsigned char *dst, const unsigned char *src, size_t size)
+{
+  if (size >= WORD_MIN)
+    {
+      size_t words;
+
+      for (; (uintptr_t) dst % 4 != 0; size--)
+        *dst++ = *src++;
+      words = size / 4;
+      size %= 4;
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+    }
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+/* Copies SIZE bytes upward from SRC to DST, 64 bytes at a time
+   through XMM0...XMM3 once DST is 16-byte aligned.
+
+   The XMM registers are not saved when threads switch, so
+   interrupts stay off while they hold our data, and they get
+   back what they held before, which may belong to a user
+   program.  Interrupts go back on between chunks of SSE2_CHUNK
+   bytes. */
+static void
+copy_sse2 (unsigned char *dst, const unsigned char *src, size_t size)
+{
+  uint8_t saved[64];
+  size_t head = -(uintptr_t) dst % 16;
+
+  copy_forward (dst, src, head);
+  dst += head;
+  src += head;
+  size -= head;
+
+  while (size >= 64)
+    {
+      size_t chunk = size < SSE2_CHUNK ? size / 64 * 64 : SSE2_CHUNK;
+      uint32_t flags;
+
+      size -= chunk;
+      asm volatile ("pushfl; popl %0; cli" : "=r" (flags));
+      asm volatile ("movdqu %%xmm0, (%0); movdqu %%xmm1, 16(%0);"
+                    "movdqu %%xmm2, 32(%0); movdqu %%xmm3, 48(%0)"
+                    : : "r" (saved) : "memory");
+      for (; chunk > 0; chunk -= 64, dst += 64, src += 64)
+        asm volatile ("movdqu (%1), %%xmm0; movdqu 16(%1), %%xmm1;"
+                      "movdqu 32(%1), %%xmm2; movdqu 48(%1), %%xmm3;"
+                      "movdqa %%xmm0, (%0); movdqa %%xmm1, 16(%0);"
+                      "movdqa %%xmm2, 32(%0); movdqa %%xmm3, 48(%0)"
+                      : : "r" (dst), "r" (src) : "memory");
+      asm volatile ("movdqu (%0), %%xmm0; movdqu 16(%0), %%xmm1;"
+                    "movdqu 32(%0), %%xmm2; movdqu 48(%0), %%xmm3"
+                    : : "r" (saved) : "memory");
+      asm volatile ("pushl %0; popfl" : : "r" (flags) : "memory", "cc");
+    }
+  copy_forward (dst, src, size);
+}
+
+/* Sets the SIZE bytes at DST to VALUE, a word at a time with
+   "rep stosl" once DST is word-aligned. */
+static void
+set_forward (unsigned char *dst, unsigned char value, size_t size)
+{
+  if (size >= WORD_MIN)
+    {
+      uint32_t pattern = value * 0x01010101u;
+      size_t words;
+
+      for (; (uintptr_t) dst % 4 != 0; size--)
+        *dst++ = value;
+      words = size / 4;
+      size %= 4;
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words) : "a" (pattern) : "memory");
+    }
+  while (size-- > 0)
+    *dst++ = value;
+}
+
+/* Sets the SIZE bytes at DST to VALUE, 64 bytes at a time from
+   XMM0 once DST is 16-byte aligned.  XMM0 is saved and
+   restored, with interrupts off, as in copy_sse2(). */
+static void
+set_sse2 (unsigned char *dst, unsigned char value, size_t size)
+{
+  uint32_t pattern[4];
+  uint8_t saved[16];
+  size_t head = -(uintptr_t) dst % 16;
+  int i;
+
+  set_forward (dst, value, head);
+  dst += head;
+  size -= head;
+  for (i = 0; i < 4; i++)
+    pattern[i] = value * 0x01010101u;
+
+  while (size >= 64)
+    {
+      size_t chunk = size < SSE2_CHUNK ? size / 64 * 64 : SSE2_CHUNK;
+      uint32_t flags;
+
+      size -= chunk;
+      asm volatile ("pushfl; popl %0; cli" : "=r" (flags));
+      asm volatile ("movdqu %%xmm0, (%0); movdqu (%1), %%xmm0"
+                    : : "r" (saved), "r" (pattern) : "memory");
+      for (; chunk > 0; chunk -= 64, dst += 64)
+        asm volatile ("movdqa %%xmm0, (%0); movdqa %%xmm0, 16(%0);"
+                      "movdqa %%xmm0, 32(%0); movdqa %%xmm0, 48(%0)"
+                      : : "r" (dst) : "memory");
+      asm volatile ("movdqu (%0), %%xmm0" : : "r" (saved) : "memory");
+      asm volatile ("pushl %0; popfl" : : "r" (flags) : "memory", "cc");
+    }
+  set_forward (dst, value, size);
+}
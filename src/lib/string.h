@@ -1,6 +1,7 @@
 #ifndef __LIB_STRING_H
 #define __LIB_STRING_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* Standard. */
@@ -24,6 +25,7 @@ size_t strlcpy (char *, const char *, size_t);
 size_t strlcat (char *, const char *, size_t);
 char *strtok_r (char *, const char *, char **);
 size_t strnlen (const char *, size_t);
+extern bool string_sse2;
 
 /* Try to be helpful. */
 #define strcpy dont_use_strcpy_use_strlcpy
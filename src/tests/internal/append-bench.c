@@ -0,0 +1,104 @@
+/* Interleaved append benchmark for filesys/inode.c.
+
+   Builds FILE_CNT files of FILE_SIZE bytes each by appending
+   RECORD_SIZE-byte records to each in turn, as several logs
+   written at once would, then reports how many extents each file
+   ended up in and the timer ticks taken to read all of them back
+   sequentially, followed by the block device statistics.  Sectors
+   for appended data are allocated only when it is written back,
+   a buffer at a time, so each file should be in a few long
+   extents rather than one per sector.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Number of files written at once. */
+#define FILE_CNT 4
+
+/* Size of each file, in bytes. */
+#define FILE_SIZE (256 * 1024)
+
+/* Bytes appended to a file at a time. */
+#define RECORD_SIZE 100
+
+/* Bytes read back at a time. */
+#define CHUNK_SIZE (64 * 1024)
+
+/* Times reads of files built by interleaved appends. */
+void
+test (void)
+{
+  struct file *files[FILE_CNT];
+  char name[16];
+  uint8_t *buf;
+  int64_t start;
+  off_t ofs;
+  int i;
+
+  buf = malloc (CHUNK_SIZE);
+  ASSERT (buf != NULL);
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "log%d", i);
+      ASSERT (filesys_create (name, 0));
+      files[i] = filesys_open (name);
+      ASSERT (files[i] != NULL);
+    }
+  for (ofs = 0; ofs < FILE_SIZE; ofs += RECORD_SIZE)
+    for (i = 0; i < FILE_CNT; i++)
+      {
+        off_t size = FILE_SIZE - ofs < RECORD_SIZE ? FILE_SIZE - ofs
+                                                   : RECORD_SIZE;
+        size_t j;
+
+        for (j = 0; j < (size_t) size; j++)
+          buf[j] = (ofs + j + i) % 251;
+        ASSERT (file_write (files[i], buf, size) == size);
+      }
+  for (i = 0; i < FILE_CNT; i++)
+    file_close (files[i]);
+
+  block_print_stats ();
+  start = timer_ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      struct file *file;
+
+      snprintf (name, sizeof name, "log%d", i);
+      file = filesys_open (name);
+      ASSERT (file != NULL);
+      ASSERT (file_length (file) == FILE_SIZE);
+      printf ("%s: %zu extents\n", name,
+              inode_extent_cnt (file_get_inode (file)));
+      for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+        {
+          size_t j;
+
+          ASSERT (file_read (file, buf, CHUNK_SIZE) == CHUNK_SIZE);
+          for (j = 0; j < CHUNK_SIZE; j++)
+            ASSERT (buf[j] == (ofs + j + i) % 251);
+        }
+      file_close (file);
+      ASSERT (filesys_remove (name));
+    }
+  printf ("%d files of %d bytes read in %"PRId64" ticks\n",
+          FILE_CNT, FILE_SIZE, timer_elapsed (start));
+  block_print_stats ();
+  free (buf);
+
+  printf ("append-bench: PASS\n");
+}
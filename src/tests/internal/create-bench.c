@@ -0,0 +1,77 @@
+/* File creation benchmark for filesys/inode.c.
+
+   Creates FILE_CNT files of FILE_SIZE bytes each, reads back the
+   first and last sector of each, and reports the timer ticks
+   spent creating them and the block device statistics before
+   and after.  A new file's data is a hole that reads as zeros,
+   so creating one should write only metadata, however large it
+   is.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/test.h"
+
+/* Number of files to create. */
+#define FILE_CNT 20
+
+/* Initial size of each file, in bytes. */
+#define FILE_SIZE (1024 * 1024)
+
+static void check_zeros (const char *name, off_t ofs);
+
+/* Times creation of large files. */
+void
+test (void)
+{
+  char name[NAME_MAX + 1];
+  int64_t start;
+  int i;
+
+  block_print_stats ();
+  start = timer_ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "sparse%d", i);
+      ASSERT (filesys_create (name, FILE_SIZE));
+    }
+  printf ("%d creates of %d bytes in %"PRId64" ticks\n",
+          FILE_CNT, FILE_SIZE, timer_elapsed (start));
+  block_print_stats ();
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "sparse%d", i);
+      check_zeros (name, 0);
+      check_zeros (name, FILE_SIZE - 512);
+      ASSERT (filesys_remove (name));
+    }
+
+  printf ("create-bench: PASS\n");
+}
+
+/* Checks that the 512 bytes at OFS in file NAME are zeros. */
+static void
+check_zeros (const char *name, off_t ofs)
+{
+  static char buf[512];
+  struct file *file = filesys_open (name);
+  size_t i;
+
+  ASSERT (file != NULL);
+  ASSERT (file_length (file) == FILE_SIZE);
+  ASSERT (file_read_at (file, buf, sizeof buf, ofs) == sizeof buf);
+  for (i = 0; i < sizeof buf; i++)
+    ASSERT (buf[i] == 0);
+  file_close (file);
+}
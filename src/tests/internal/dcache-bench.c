@@ -0,0 +1,85 @@
+/* Path lookup benchmark for filesys/dcache.c.
+
+   Creates a file DEPTH directories deep, then opens it OPEN_CNT
+   times by its full path, and looks up as many names that do not
+   exist in its directory.  Reports the timer ticks spent and the
+   block device statistics before and after.  Once the first walk
+   has filled the directory entry cache, the others should not
+   read the disk at all.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "filesys/dcache.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/test.h"
+
+/* Number of directories to nest. */
+#define DEPTH 8
+
+/* Number of times to open the file. */
+#define OPEN_CNT 1000
+
+/* Times repeated opens of a deeply nested path. */
+void
+test (void)
+{
+  char path[DEPTH * 6 + 16];
+  char missing[DEPTH * 6 + 16];
+  struct file *file;
+  int64_t start;
+  int i;
+
+  path[0] = '\0';
+  for (i = 0; i < DEPTH; i++)
+    {
+      snprintf (path + strlen (path), sizeof path - strlen (path),
+                "/dir%d", i);
+      ASSERT (filesys_mkdir (path));
+    }
+  snprintf (missing, sizeof missing, "%s/missing", path);
+  strlcat (path, "/file", sizeof path);
+  ASSERT (filesys_create (path, 0));
+
+  /* Warm up the cache. */
+  file = filesys_open (path);
+  ASSERT (file != NULL);
+  file_close (file);
+  block_print_stats ();
+
+  start = timer_ticks ();
+  for (i = 0; i < OPEN_CNT; i++)
+    {
+      file = filesys_open (path);
+      ASSERT (file != NULL);
+      file_close (file);
+    }
+  printf ("%d opens of %s in %"PRId64" ticks\n",
+          OPEN_CNT, path, timer_elapsed (start));
+
+  start = timer_ticks ();
+  for (i = 0; i < OPEN_CNT; i++)
+    ASSERT (filesys_open (missing) == NULL);
+  printf ("%d failed opens of %s in %"PRId64" ticks\n",
+          OPEN_CNT, missing, timer_elapsed (start));
+  block_print_stats ();
+  dcache_print_stats ();
+
+  ASSERT (filesys_remove (path));
+  for (i = DEPTH - 1; i >= 0; i--)
+    {
+      *strrchr (path, '/') = '\0';
+      ASSERT (filesys_remove (path));
+    }
+
+  printf ("dcache-bench: PASS\n");
+}
@@ -0,0 +1,74 @@
+/* Metadata benchmark for filesys/directory.c.
+
+   Creates, looks up and deletes FILE_CNT files in the root
+   directory and reports the number of timer ticks spent in each
+   phase.  Directories this large are served by the hashed
+   directory index, so each phase should take time roughly
+   proportional to FILE_CNT rather than its square.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/directory.h"
+#include "threads/test.h"
+
+/* Number of files to create. */
+#define FILE_CNT 5000
+
+static void make_name (char[NAME_MAX + 1], int);
+
+/* Times file creation, lookup and deletion. */
+void
+test (void)
+{
+  char name[NAME_MAX + 1];
+  int64_t start;
+  int i;
+
+  start = timer_ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      make_name (name, i);
+      ASSERT (filesys_create (name, 0));
+    }
+  printf ("create: %d files in %"PRId64" ticks\n",
+          FILE_CNT, timer_elapsed (start));
+
+  start = timer_ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      struct file *file;
+
+      make_name (name, i);
+      file = filesys_open (name);
+      ASSERT (file != NULL);
+      file_close (file);
+    }
+  printf ("lookup: %d files in %"PRId64" ticks\n",
+          FILE_CNT, timer_elapsed (start));
+
+  start = timer_ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      make_name (name, i);
+      ASSERT (filesys_remove (name));
+    }
+  printf ("remove: %d files in %"PRId64" ticks\n",
+          FILE_CNT, timer_elapsed (start));
+
+  printf ("dir-bench: PASS\n");
+}
+
+/* Stores the name of file number I into NAME. */
+static void
+make_name (char name[NAME_MAX + 1], int i)
+{
+  snprintf (name, NAME_MAX + 1, "bench%d", i);
+}
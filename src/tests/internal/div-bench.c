@@ -0,0 +1,237 @@
+/* Benchmark for the 64-bit division routines in lib/arithmetic.c.
+
+   For each of several kinds of operands (a dividend that fits in
+   32 bits, a 64-bit dividend with a 32-bit divisor and a 32-bit
+   or 64-bit quotient, and a 64-bit divisor), checks that the
+   quotient and remainder computed by GCC's __udivdi3() and
+   __umoddi3() agree with the previous implementation, copied
+   below, and with each other, and then times both by the
+   processor's time-stamp counter and reports cycles per
+   division.  Signed division is checked the same way.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Number of operand pairs of each kind. */
+#define PAIR_CNT 1024
+
+/* Number of times each set of pairs is divided when timing. */
+#define ROUND_CNT 200
+
+/* Operand pairs. */
+static uint64_t dividends[PAIR_CNT];
+static uint64_t divisors[PAIR_CNT];
+
+static void make_pairs (int kind);
+static void check_pairs (void);
+static void time_pairs (const char *name);
+static uint64_t old_udiv64 (uint64_t n, uint64_t d);
+
+/* Returns the processor's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Checks and times each kind of division. */
+void
+test (void)
+{
+  static const char *names[] =
+    {
+      "32-bit / 32-bit",
+      "64-bit / 32-bit, 32-bit quotient",
+      "64-bit / 32-bit, 64-bit quotient",
+      "64-bit / 64-bit",
+    };
+  size_t kind;
+
+  for (kind = 0; kind < sizeof names / sizeof *names; kind++)
+    {
+      make_pairs (kind);
+      check_pairs ();
+      time_pairs (names[kind]);
+    }
+
+  printf ("div-bench: PASS\n");
+}
+
+/* Returns a random 64-bit number. */
+static uint64_t
+random_u64 (void)
+{
+  return ((uint64_t) random_ulong () << 32) | random_ulong ();
+}
+
+/* Fills dividends[] and divisors[] with pairs of the given
+   KIND, an index into the names in test(). */
+static void
+make_pairs (int kind)
+{
+  size_t i;
+
+  for (i = 0; i < PAIR_CNT; i++)
+    {
+      uint64_t n = random_u64 ();
+      uint64_t d = random_u64 () >> (random_ulong () % 32);
+
+      switch (kind)
+        {
+        case 0:
+          n = (uint32_t) n;
+          d = (uint32_t) d;
+          break;
+        case 1:
+          d = (uint32_t) d | (1u << 31);
+          n = (n >> 32) % d << 32 | (uint32_t) n;
+          break;
+        case 2:
+          d = (uint32_t) d >> (random_ulong () % 31);
+          n |= (d + 1) << 32;
+          break;
+        default:
+          if (d >> 32 == 0)
+            d |= 1ULL << 32;
+          break;
+        }
+      if (d == 0)
+        d = 1;
+      dividends[i] = n;
+      divisors[i] = d;
+    }
+}
+
+/* Checks division of each pair against the previous
+   implementation and against the definition of the remainder,
+   unsigned and signed. */
+static void
+check_pairs (void)
+{
+  size_t i;
+
+  for (i = 0; i < PAIR_CNT; i++)
+    {
+      uint64_t n = dividends[i], d = divisors[i];
+      uint64_t q = n / d, r = n % d;
+      int64_t sn = -(int64_t) (n >> 1), sd = (int64_t) (d >> 1) | 1;
+
+      ASSERT (q == old_udiv64 (n, d));
+      ASSERT (r < d && q * d + r == n);
+
+      ASSERT (sn / sd * sd + sn % sd == sn);
+      ASSERT (sn % sd <= 0 && sn % sd > -sd);
+      ASSERT (sn / -sd == -(sn / sd) && sn % -sd == sn % sd);
+    }
+}
+
+/* Times division of each pair, by lib/arithmetic.c and by the
+   previous implementation, and prints the results under NAME. */
+static void
+time_pairs (const char *name)
+{
+  uint64_t sum, old_sum, cycles, old_cycles;
+  size_t i;
+  int round;
+
+  sum = 0;
+  cycles = rdtsc ();
+  for (round = 0; round < ROUND_CNT; round++)
+    for (i = 0; i < PAIR_CNT; i++)
+      sum += dividends[i] / divisors[i];
+  cycles = rdtsc () - cycles;
+
+  old_sum = 0;
+  old_cycles = rdtsc ();
+  for (round = 0; round < ROUND_CNT; round++)
+    for (i = 0; i < PAIR_CNT; i++)
+      old_sum += old_udiv64 (dividends[i], divisors[i]);
+  old_cycles = rdtsc () - old_cycles;
+
+  ASSERT (sum == old_sum);
+  printf ("%s: %"PRIu64" cycles per division, previously %"PRIu64"\n",
+          name, cycles / (ROUND_CNT * PAIR_CNT),
+          old_cycles / (ROUND_CNT * PAIR_CNT));
+}
+
+/* The previous implementation of unsigned 64-bit division, for
+   comparison. */
+
+static inline uint32_t
+old_divl (uint64_t n, uint32_t d)
+{
+  uint32_t n1 = n >> 32;
+  uint32_t n0 = n;
+  uint32_t q, r;
+
+  asm ("divl %4"
+       : "=d" (r), "=a" (q)
+       : "0" (n1), "1" (n0), "rm" (d));
+
+  return q;
+}
+
+static int
+old_nlz (uint32_t x)
+{
+  int n = 0;
+  if (x <= 0x0000FFFF)
+    {
+      n += 16;
+      x <<= 16;
+    }
+  if (x <= 0x00FFFFFF)
+    {
+      n += 8;
+      x <<= 8;
+    }
+  if (x <= 0x0FFFFFFF)
+    {
+      n += 4;
+      x <<= 4;
+    }
+  if (x <= 0x3FFFFFFF)
+    {
+      n += 2;
+      x <<= 2;
+    }
+  if (x <= 0x7FFFFFFF)
+    n++;
+  return n;
+}
+
+static uint64_t NO_INLINE
+old_udiv64 (uint64_t n, uint64_t d)
+{
+  if ((d >> 32) == 0)
+    {
+      uint64_t b = 1ULL << 32;
+      uint32_t n1 = n >> 32;
+      uint32_t n0 = n;
+      uint32_t d0 = d;
+
+      return old_divl (b * (n1 % d0) + n0, d0) + b * (n1 / d0);
+    }
+  else
+    {
+      if (n < d)
+        return 0;
+      else
+        {
+          uint32_t d1 = d >> 32;
+          int s = old_nlz (d1);
+          uint64_t q = old_divl (n >> 1, (d << s) >> 32) >> (31 - s);
+          return n - (q - 1) * d < d ? q - 1 : q;
+        }
+    }
+}
@@ -0,0 +1,118 @@
+/* CPU cost benchmark for IDE bus-master DMA.
+
+   Writes and then reads the first SPAN_SIZE bytes of the scratch
+   device in REQUEST-sector requests, first by DMA and then, with
+   ide_dma turned off, by PIO, and reports for each the
+   throughput and the CPU time consumed per megabyte transferred.
+   The CPU time is the elapsed time less the time the idle thread
+   ran, so nothing else should be running.  Checks that the data
+   read back is what was written.  Overwrites the start of the
+   scratch device.
+
+   The disk must be attached to a controller that supports
+   bus-master DMA, such as the PIIX that QEMU emulates; otherwise
+   both runs use PIO.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/ide.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+#include "threads/thread.h"
+
+/* Bytes written and read for each transfer method. */
+#define SPAN_SIZE (16 * 1024 * 1024)
+#define SPAN_SECTORS (SPAN_SIZE / BLOCK_SECTOR_SIZE)
+
+/* Sectors per request. */
+#define REQUEST 128
+
+static void time_span (struct block *, uint8_t *);
+static void report (const char *op, int64_t start, int64_t idle_start);
+
+/* Times transfers by DMA and by PIO. */
+void
+test (void)
+{
+  struct block *scratch = block_get_role (BLOCK_SCRATCH);
+  uint8_t *buf = malloc (REQUEST * BLOCK_SECTOR_SIZE);
+  bool dma = ide_dma;
+
+  ASSERT (scratch != NULL);
+  ASSERT (block_size (scratch) >= SPAN_SECTORS);
+  ASSERT (buf != NULL);
+
+  time_span (scratch, buf);
+  ide_dma = false;
+  time_span (scratch, buf);
+  ide_dma = dma;
+
+  free (buf);
+  printf ("dma-bench: PASS\n");
+}
+
+/* Returns the byte at offset OFS in the data written by each
+   request. */
+static uint8_t
+pattern (size_t ofs)
+{
+  return (ofs / BLOCK_SECTOR_SIZE) * 11 + ofs % 253;
+}
+
+/* Writes and then reads SPAN_SECTORS sectors of SCRATCH, REQUEST
+   sectors at a time, using BUF. */
+static void
+time_span (struct block *scratch, uint8_t *buf)
+{
+  block_sector_t sector;
+  int64_t start, idle_start;
+  size_t i;
+
+  for (i = 0; i < REQUEST * BLOCK_SECTOR_SIZE; i++)
+    buf[i] = pattern (i);
+
+  start = timer_ticks ();
+  idle_start = thread_idle_ticks ();
+  for (sector = 0; sector < SPAN_SECTORS; sector += REQUEST)
+    block_write_multi (scratch, sector, REQUEST, buf);
+  report ("write", start, idle_start);
+
+  start = timer_ticks ();
+  idle_start = thread_idle_ticks ();
+  for (sector = 0; sector < SPAN_SECTORS; sector += REQUEST)
+    block_read_multi (scratch, sector, REQUEST, buf);
+  report ("read", start, idle_start);
+
+  /* Every request wrote the same data, so the last one read
+     should have read it back. */
+  for (i = 0; i < REQUEST * BLOCK_SECTOR_SIZE; i++)
+    ASSERT (buf[i] == pattern (i));
+}
+
+/* Prints the throughput and CPU time per megabyte of SPAN_SIZE
+   bytes transferred by the operation named OP, which began at
+   timer tick START, when the idle thread had run for IDLE_START
+   ticks. */
+static void
+report (const char *op, int64_t start, int64_t idle_start)
+{
+  int64_t ticks = timer_elapsed (start);
+  int64_t busy = ticks - (thread_idle_ticks () - idle_start);
+  int mb = SPAN_SIZE / (1024 * 1024);
+
+  if (ticks == 0)
+    ticks = 1;
+  printf ("%s by %s: %"PRId64" kB/s, %"PRId64" ms of CPU per MB "
+          "(%"PRId64" of %"PRId64" ticks busy)\n",
+          op, ide_dma ? "DMA" : "PIO",
+          (int64_t) SPAN_SIZE / 1024 * TIMER_FREQ / ticks,
+          busy * 1000 / TIMER_FREQ / mb, busy, ticks);
+}
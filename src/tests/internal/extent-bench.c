@@ -0,0 +1,70 @@
+/* Sequential throughput benchmark for filesys/inode.c.
+
+   Writes a FILE_SIZE-byte file in CHUNK_SIZE-byte pieces, growing
+   it as it goes, then reads it back the same way, and reports the
+   number of timer ticks taken by each pass.  Compare the figures
+   against a kernel built with a per-sector block map to see what
+   mapping data by extents saves.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Size of the file, in bytes. */
+#define FILE_SIZE (2 * 1024 * 1024)
+
+/* Bytes written or read at a time. */
+#define CHUNK_SIZE 4096
+
+/* Times sequential writes and reads of a large file. */
+void
+test (void)
+{
+  struct file *file;
+  uint8_t *buf;
+  int64_t start;
+  off_t ofs;
+
+  buf = malloc (CHUNK_SIZE);
+  ASSERT (buf != NULL);
+  ASSERT (filesys_create ("extent", 0));
+  file = filesys_open ("extent");
+  ASSERT (file != NULL);
+
+  start = timer_ticks ();
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      memset (buf, ofs / CHUNK_SIZE, CHUNK_SIZE);
+      ASSERT (file_write (file, buf, CHUNK_SIZE) == CHUNK_SIZE);
+    }
+  printf ("write: %d bytes in %"PRId64" ticks\n",
+          FILE_SIZE, timer_elapsed (start));
+
+  file_seek (file, 0);
+  start = timer_ticks ();
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      ASSERT (file_read (file, buf, CHUNK_SIZE) == CHUNK_SIZE);
+      ASSERT (buf[0] == (uint8_t) (ofs / CHUNK_SIZE));
+      ASSERT (buf[CHUNK_SIZE - 1] == (uint8_t) (ofs / CHUNK_SIZE));
+    }
+  printf ("read: %d bytes in %"PRId64" ticks\n",
+          FILE_SIZE, timer_elapsed (start));
+
+  file_close (file);
+  ASSERT (filesys_remove ("extent"));
+  free (buf);
+
+  printf ("extent-bench: PASS\n");
+}
@@ -0,0 +1,175 @@
+/* Throughput benchmark for fsutil_extract().
+
+   Writes a ustar archive of FILE_CNT files, ARCHIVE_SIZE bytes in
+   all, to the start of the scratch device, extracts it into the
+   file system with fsutil_extract(), and reports the extraction
+   rate in MB/s, followed by the block device statistics.  Then
+   checks the contents of every extracted file and removes them.
+   The scratch device must hold at least ARCHIVE_SIZE bytes plus
+   a sector per file, and the file system must have room for the
+   files.  Don't run it after an `extract' action, because
+   fsutil_extract() resumes where the last extraction stopped.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <ustar.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/fsutil.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Total size of the files in the archive. */
+#define ARCHIVE_SIZE (10 * 1024 * 1024)
+
+/* Number of files in the archive. */
+#define FILE_CNT 10
+
+/* Sectors written to the scratch device at a time. */
+#define BUF_SECTORS 64
+#define BUF_SIZE (BUF_SECTORS * BLOCK_SECTOR_SIZE)
+
+static void write_archive (struct block *, uint8_t *buf);
+static void check_file (int idx, uint8_t *buf);
+static void file_name (int idx, char name[]);
+static int file_size (int idx);
+static uint8_t file_byte (int idx, int ofs);
+
+/* Writes, extracts and checks an archive. */
+void
+test (void)
+{
+  struct block *scratch = block_get_role (BLOCK_SCRATCH);
+  uint8_t *buf = malloc (BUF_SIZE);
+  int64_t start, ticks;
+  int i;
+
+  ASSERT (scratch != NULL);
+  ASSERT (buf != NULL);
+
+  write_archive (scratch, buf);
+
+  start = timer_ticks ();
+  fsutil_extract (NULL);
+  ticks = timer_elapsed (start);
+  if (ticks == 0)
+    ticks = 1;
+  printf ("extracted %d bytes in %d files: %"PRId64" kB/s "
+          "(%"PRId64" MB/s)\n",
+          ARCHIVE_SIZE, FILE_CNT,
+          (int64_t) ARCHIVE_SIZE / 1024 * TIMER_FREQ / ticks,
+          (int64_t) ARCHIVE_SIZE / (1024 * 1024) * TIMER_FREQ / ticks);
+  block_print_stats ();
+
+  for (i = 0; i < FILE_CNT; i++)
+    check_file (i, buf);
+  free (buf);
+
+  printf ("extract-bench: PASS\n");
+}
+
+/* Writes the archive to the start of SCRATCH, using BUF, which
+   must hold BUF_SIZE bytes. */
+static void
+write_archive (struct block *scratch, uint8_t *buf)
+{
+  block_sector_t sector = 0;
+  int i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      char name[16];
+      int size = file_size (i);
+      int ofs;
+
+      file_name (i, name);
+      ASSERT (ustar_make_header (name, USTAR_REGULAR, size,
+                                 (char *) buf));
+      block_write (scratch, sector++, buf);
+
+      for (ofs = 0; ofs < size; ofs += BUF_SIZE)
+        {
+          int chunk = size - ofs < BUF_SIZE ? size - ofs : BUF_SIZE;
+          block_sector_t cnt = DIV_ROUND_UP (chunk, BLOCK_SECTOR_SIZE);
+          int j;
+
+          for (j = 0; j < chunk; j++)
+            buf[j] = file_byte (i, ofs + j);
+          for (; j < (int) (cnt * BLOCK_SECTOR_SIZE); j++)
+            buf[j] = 0;
+          ASSERT (sector + cnt <= block_size (scratch));
+          block_write_multi (scratch, sector, cnt, buf);
+          sector += cnt;
+        }
+    }
+
+  /* Two sectors of zeros end the archive. */
+  for (i = 0; i < 2 * BLOCK_SECTOR_SIZE; i++)
+    buf[i] = 0;
+  ASSERT (sector + 2 <= block_size (scratch));
+  block_write_multi (scratch, sector, 2, buf);
+}
+
+/* Checks that file IDX was extracted intact and removes it,
+   using BUF, which must hold BUF_SIZE bytes. */
+static void
+check_file (int idx, uint8_t *buf)
+{
+  char name[16];
+  struct file *file;
+  int size = file_size (idx);
+  int ofs;
+
+  file_name (idx, name);
+  file = filesys_open (name);
+  ASSERT (file != NULL);
+  ASSERT (file_length (file) == size);
+  for (ofs = 0; ofs < size; ofs += BUF_SIZE)
+    {
+      int chunk = size - ofs < BUF_SIZE ? size - ofs : BUF_SIZE;
+      int j;
+
+      ASSERT (file_read (file, buf, chunk) == chunk);
+      for (j = 0; j < chunk; j++)
+        ASSERT (buf[j] == file_byte (idx, ofs + j));
+    }
+  file_close (file);
+  ASSERT (filesys_remove (name));
+}
+
+/* Stores the name of file IDX in NAME. */
+static void
+file_name (int idx, char name[])
+{
+  snprintf (name, 16, "extract-%d", idx);
+}
+
+/* Returns the size of file IDX.  The sizes add up to
+   ARCHIVE_SIZE, and most of them end partway through a
+   sector. */
+static int
+file_size (int idx)
+{
+  int size = ARCHIVE_SIZE / FILE_CNT;
+
+  if (idx < FILE_CNT - 1)
+    return size - idx * 100;
+  else
+    return size + (FILE_CNT - 1) * (FILE_CNT - 2) / 2 * 100;
+}
+
+/* Returns the byte at offset OFS in file IDX. */
+static uint8_t
+file_byte (int idx, int ofs)
+{
+  return (ofs * 7 + idx * 13) % 251;
+}
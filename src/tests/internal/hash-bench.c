@@ -0,0 +1,118 @@
+/* Insertion latency benchmark for lib/kernel/hash.c.
+
+   Inserts ELEM_CNT elements into an empty hash table, timing each
+   insertion with the processor's time-stamp counter, and reports
+   the median, 99th and 99.9th percentile and maximum cycles per
+   insertion.  The table doubles in size many times along the
+   way.  Because each resize moves the elements a few buckets at
+   a time, the maximum should stay within a small multiple of the
+   median, rather than growing with the size of the table.  Then
+   looks up and deletes every element, which also finishes any
+   resize in progress.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Number of elements to insert. */
+#define ELEM_CNT 32768
+
+/* A hash table element. */
+struct value
+  {
+    struct hash_elem elem;      /* Hash element. */
+    int key;                    /* Key. */
+  };
+
+static hash_hash_func value_hash;
+static hash_less_func value_less;
+static int compare_cycles (const void *, const void *);
+
+/* Returns the processor's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Times insertions into a growing hash table. */
+void
+test (void)
+{
+  struct value *values = malloc (ELEM_CNT * sizeof *values);
+  uint32_t *cycles = malloc (ELEM_CNT * sizeof *cycles);
+  struct hash h;
+  int i;
+
+  ASSERT (values != NULL && cycles != NULL);
+  ASSERT (hash_init (&h, value_hash, value_less, NULL));
+
+  for (i = 0; i < ELEM_CNT; i++)
+    {
+      uint64_t start;
+
+      values[i].key = i;
+      start = rdtsc ();
+      ASSERT (hash_insert (&h, &values[i].elem) == NULL);
+      cycles[i] = rdtsc () - start;
+    }
+
+  qsort (cycles, ELEM_CNT, sizeof *cycles, compare_cycles);
+  printf ("%d inserts, cycles per insert: median %"PRIu32", "
+          "p99 %"PRIu32", p99.9 %"PRIu32", max %"PRIu32"\n",
+          ELEM_CNT, cycles[ELEM_CNT / 2], cycles[ELEM_CNT * 99 / 100],
+          cycles[ELEM_CNT * 999 / 1000], cycles[ELEM_CNT - 1]);
+
+  ASSERT (hash_size (&h) == ELEM_CNT);
+  for (i = 0; i < ELEM_CNT; i++)
+    {
+      struct value key;
+
+      key.key = i;
+      ASSERT (hash_find (&h, &key.elem) == &values[i].elem);
+      ASSERT (hash_delete (&h, &key.elem) == &values[i].elem);
+    }
+  ASSERT (hash_empty (&h));
+
+  hash_destroy (&h, NULL);
+  free (cycles);
+  free (values);
+
+  printf ("hash-bench: PASS\n");
+}
+
+/* Returns a hash value for the value that contains E. */
+static unsigned
+value_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct value, elem)->key);
+}
+
+/* Returns true if value A's key is less than B's. */
+static bool
+value_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct value, elem)->key
+          < hash_entry (b, struct value, elem)->key);
+}
+
+/* qsort() comparison function for cycle counts. */
+static int
+compare_cycles (const void *a_, const void *b_)
+{
+  const uint32_t *a = a_;
+  const uint32_t *b = b_;
+  return *a < *b ? -1 : *a > *b;
+}
@@ -0,0 +1,146 @@
+/* Test program for lib/kernel/heap.c.
+
+   Sorts values of various sizes by inserting them into a heap in
+   random order and popping them back out, then removes values
+   from the middle of heaps at random and checks that the rest
+   still come out in order.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <heap.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a heap that we will test. */
+#define MAX_SIZE 128
+
+/* A heap element. */
+struct value
+  {
+    struct heap_elem elem;      /* Heap element. */
+    int value;                  /* Item value. */
+    bool removed;               /* Removed with heap_remove()? */
+  };
+
+static void shuffle (struct value *[], size_t);
+static bool value_less (const struct heap_elem *, const struct heap_elem *,
+                        void *);
+
+/* Tests the pairing heap implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size heaps:");
+  for (size = 0; size < MAX_SIZE; size++)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE];
+          static struct value *order[MAX_SIZE];
+          struct heap heap;
+          struct heap_elem *e;
+          int i, last, remove_cnt;
+
+          /* Insert values 0...SIZE, some of them twice over, in
+             random order. */
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = i / 2;
+              values[i].removed = false;
+              order[i] = &values[i];
+            }
+          shuffle (order, size);
+          heap_init (&heap, value_less, NULL);
+          for (i = 0; i < size; i++)
+            {
+              heap_insert (&heap, &order[i]->elem);
+              ASSERT (heap_size (&heap) == (size_t) i + 1);
+            }
+
+          /* Pop half of them, which should come out in order. */
+          for (i = 0; i < size / 2; i++)
+            {
+              e = heap_pop_min (&heap);
+              ASSERT (heap_entry (e, struct value, elem)->value == i / 2);
+              heap_entry (e, struct value, elem)->removed = true;
+            }
+
+          /* Put them back. */
+          for (i = 0; i < size; i++)
+            if (values[i].removed)
+              {
+                values[i].removed = false;
+                heap_insert (&heap, &values[i].elem);
+              }
+          ASSERT (heap_size (&heap) == (size_t) size);
+
+          /* Remove some from wherever they are in the heap. */
+          remove_cnt = size > 0 ? random_ulong () % (size + 1) : 0;
+          shuffle (order, size);
+          for (i = 0; i < remove_cnt; i++)
+            {
+              heap_remove (&heap, &order[i]->elem);
+              order[i]->removed = true;
+            }
+          ASSERT (heap_size (&heap) == (size_t) (size - remove_cnt));
+
+          /* The rest should come out in order. */
+          last = -1;
+          for (i = 0; (e = heap_pop_min (&heap)) != NULL; i++)
+            {
+              struct value *v = heap_entry (e, struct value, elem);
+              ASSERT (!v->removed);
+              ASSERT (v->value >= last);
+              last = v->value;
+              v->removed = true;
+            }
+          ASSERT (i == size - remove_cnt);
+          ASSERT (heap_empty (&heap));
+          ASSERT (heap_min (&heap) == NULL);
+          for (i = 0; i < size; i++)
+            ASSERT (values[i].removed);
+        }
+    }
+
+  printf (" done\n");
+  printf ("heap: PASS\n");
+}
+
+/* Shuffles the CNT pointers in ARRAY into random order.  The
+   values themselves stay put, because they may be linked into a
+   heap. */
+static void
+shuffle (struct value **array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct heap_elem *a_, const struct heap_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = heap_entry (a_, struct value, elem);
+  const struct value *b = heap_entry (b_, struct value, elem);
+
+  return a->value < b->value;
+}
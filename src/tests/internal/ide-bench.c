@@ -0,0 +1,110 @@
+/* Sequential throughput benchmark for the IDE driver.
+
+   Writes and then reads the first SPAN_SIZE bytes of the scratch
+   device with requests of several sizes, through
+   block_write_multi() and block_read_multi(), and reports MB/s
+   for each, first with READ/WRITE MULTIPLE, which takes one
+   interrupt per block of sectors, and then with
+   ide_pio_multiple turned off, which takes one interrupt per
+   sector.  Checks that the data read back is what was written.
+   Overwrites the start of the scratch device.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/ide.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Bytes written and read for each request size. */
+#define SPAN_SIZE (4 * 1024 * 1024)
+#define SPAN_SECTORS (SPAN_SIZE / BLOCK_SECTOR_SIZE)
+
+/* Largest request, in sectors. */
+#define MAX_REQUEST 256
+
+static void time_span (struct block *, uint8_t *, block_sector_t request);
+static void report (const char *op, block_sector_t request, int64_t start);
+
+/* Times sequential transfers of several request sizes. */
+void
+test (void)
+{
+  static const block_sector_t requests[] = {1, 8, 64, MAX_REQUEST};
+  struct block *scratch = block_get_role (BLOCK_SCRATCH);
+  uint8_t *buf = malloc (MAX_REQUEST * BLOCK_SECTOR_SIZE);
+  bool multiple = ide_pio_multiple;
+  size_t i;
+
+  ASSERT (scratch != NULL);
+  ASSERT (block_size (scratch) >= SPAN_SECTORS);
+  ASSERT (buf != NULL);
+
+  for (i = 0; i < sizeof requests / sizeof *requests; i++)
+    time_span (scratch, buf, requests[i]);
+  ide_pio_multiple = false;
+  for (i = 0; i < sizeof requests / sizeof *requests; i++)
+    time_span (scratch, buf, requests[i]);
+  ide_pio_multiple = multiple;
+
+  free (buf);
+  printf ("ide-bench: PASS\n");
+}
+
+/* Returns the byte at offset OFS in the data written by each
+   request. */
+static uint8_t
+pattern (size_t ofs)
+{
+  return (ofs / BLOCK_SECTOR_SIZE) * 7 + ofs % 251;
+}
+
+/* Writes and then reads SPAN_SECTORS sectors of SCRATCH,
+   REQUEST sectors at a time, using BUF. */
+static void
+time_span (struct block *scratch, uint8_t *buf, block_sector_t request)
+{
+  size_t size = request * BLOCK_SECTOR_SIZE;
+  block_sector_t sector;
+  int64_t start;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    buf[i] = pattern (i);
+  start = timer_ticks ();
+  for (sector = 0; sector < SPAN_SECTORS; sector += request)
+    block_write_multi (scratch, sector, request, buf);
+  report ("write", request, start);
+
+  start = timer_ticks ();
+  for (sector = 0; sector < SPAN_SECTORS; sector += request)
+    block_read_multi (scratch, sector, request, buf);
+  report ("read", request, start);
+
+  /* Every request wrote the same data, so the last one read
+     should have read it back. */
+  for (i = 0; i < size; i++)
+    ASSERT (buf[i] == pattern (i));
+}
+
+/* Prints the throughput of SPAN_SIZE bytes transferred by the
+   operation named OP in requests of REQUEST sectors, which began
+   at timer tick START. */
+static void
+report (const char *op, block_sector_t request, int64_t start)
+{
+  int64_t ticks = timer_elapsed (start);
+
+  if (ticks == 0)
+    ticks = 1;
+  printf ("%s, %"PRDSNu"-sector requests%s: %"PRId64" kB/s\n",
+          op, request, ide_pio_multiple ? "" : " (no MULTIPLE)",
+          (int64_t) SPAN_SIZE / 1024 * TIMER_FREQ / ticks);
+}
@@ -0,0 +1,70 @@
+/* Open/close benchmark for the open inode table in
+   filesys/inode.c.
+
+   Holds FILE_CNT files open, then repeatedly reopens and closes
+   each of their inodes by sector and reports the number of timer
+   ticks taken.  With open inodes indexed by sector, the cost of
+   an open should not depend on FILE_CNT.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/directory.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Number of files to hold open. */
+#define FILE_CNT 1000
+
+/* Number of times to reopen each of them. */
+#define ROUND_CNT 20
+
+/* Times inode_open() and inode_close() with many files open. */
+void
+test (void)
+{
+  struct file **files;
+  char name[NAME_MAX + 1];
+  int64_t start;
+  int i, round;
+
+  files = malloc (FILE_CNT * sizeof *files);
+  ASSERT (files != NULL);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "open%d", i);
+      ASSERT (filesys_create (name, 0));
+      files[i] = filesys_open (name);
+      ASSERT (files[i] != NULL);
+    }
+
+  start = timer_ticks ();
+  for (round = 0; round < ROUND_CNT; round++)
+    for (i = 0; i < FILE_CNT; i++)
+      {
+        block_sector_t sector = inode_get_inumber (file_get_inode (files[i]));
+        struct inode *inode = inode_open (sector);
+        ASSERT (inode == file_get_inode (files[i]));
+        inode_close (inode);
+      }
+  printf ("%d opens and closes with %d files open in %"PRId64" ticks\n",
+          ROUND_CNT * FILE_CNT, FILE_CNT, timer_elapsed (start));
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "open%d", i);
+      file_close (files[i]);
+      ASSERT (filesys_remove (name));
+    }
+  free (files);
+
+  printf ("inode-bench: PASS\n");
+}
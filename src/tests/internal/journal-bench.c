@@ -0,0 +1,70 @@
+/* Metadata journal benchmark for filesys/journal.c.
+
+   Creates FILE_CNT small files, writes a sector of data to each,
+   then deletes them all, and syncs the journal.  Reports the
+   timer ticks spent and the journal statistics before and after.
+   Without the journal, every metadata write counted would have
+   been a synchronous write in place; with it, they are grouped
+   into commits, and a sector changed by many operations, such as
+   a directory or free map sector, reaches its home location only
+   once per checkpoint.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/directory.h"
+#include "filesys/journal.h"
+#include "threads/test.h"
+
+/* Number of files to create. */
+#define FILE_CNT 500
+
+/* Bytes of data written to each file. */
+#define FILE_SIZE 512
+
+/* Counts journal writes for file creation and deletion. */
+void
+test (void)
+{
+  static char data[FILE_SIZE];
+  char name[NAME_MAX + 1];
+  int64_t start;
+  int i;
+
+  memset (data, 'j', sizeof data);
+  journal_sync ();
+  journal_print_stats ();
+
+  start = timer_ticks ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      struct file *file;
+
+      snprintf (name, sizeof name, "jrnl%d", i);
+      ASSERT (filesys_create (name, 0));
+      file = filesys_open (name);
+      ASSERT (file != NULL);
+      ASSERT (file_write (file, data, sizeof data) == sizeof data);
+      file_close (file);
+    }
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "jrnl%d", i);
+      ASSERT (filesys_remove (name));
+    }
+  journal_sync ();
+  printf ("%d creates and removes in %"PRId64" ticks\n",
+          FILE_CNT, timer_elapsed (start));
+  journal_print_stats ();
+
+  printf ("journal-bench: PASS\n");
+}
@@ -0,0 +1,203 @@
+/* Bandwidth benchmark for memcpy(), memset() and memcmp() in
+   lib/string.c.
+
+   First checks each function against a byte-at-a-time version
+   for every alignment of source and destination within a word
+   and a range of sizes, and checks that memmove() copies
+   overlapping blocks correctly in both directions.  Then, for
+   several block sizes from a cache line to well beyond the
+   cache, times each function over BYTE_CNT bytes in total and
+   reports megabytes per second and cycles per kilobyte, by the
+   processor's time-stamp counter.  If the kernel was booted with
+   -simd and the CPU has SSE2, memcpy() and memset() are timed
+   both with and without it.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Total bytes processed for each function and block size. */
+#define BYTE_CNT (64 * 1024 * 1024)
+
+/* Largest block size. */
+#define MAX_BLOCK (256 * 1024)
+
+/* Largest size checked for correctness. */
+#define CHECK_SIZE 2100
+
+static void check_functions (uint8_t *a, uint8_t *b);
+static void time_functions (uint8_t *a, uint8_t *b, size_t block);
+static void report (const char *name, size_t block, int64_t start,
+                    uint64_t cycles);
+
+/* Returns the processor's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Checks and then times the string functions. */
+void
+test (void)
+{
+  static const size_t blocks[] = {64, 512, 4096, 65536, MAX_BLOCK};
+  uint8_t *a = malloc (MAX_BLOCK + 64);
+  uint8_t *b = malloc (MAX_BLOCK + 64);
+  bool sse2 = string_sse2;
+  size_t i;
+
+  ASSERT (a != NULL && b != NULL);
+
+  check_functions (a, b);
+  if (sse2)
+    {
+      string_sse2 = false;
+      check_functions (a, b);
+      string_sse2 = true;
+    }
+
+  for (i = 0; i < sizeof blocks / sizeof *blocks; i++)
+    {
+      time_functions (a, b, blocks[i]);
+      if (sse2)
+        {
+          string_sse2 = false;
+          time_functions (a, b, blocks[i]);
+          string_sse2 = true;
+        }
+    }
+
+  free (a);
+  free (b);
+  printf ("memcpy-bench: PASS\n");
+}
+
+/* Fills the SIZE bytes at P with a pattern that depends on
+   SEED. */
+static void
+fill (uint8_t *p, size_t size, unsigned seed)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    p[i] = (i * 31 + seed) >> 3;
+}
+
+/* Checks memcpy(), memmove(), memset() and memcmp() on blocks in
+   A and B, which must each have room for CHECK_SIZE + 8 bytes. */
+static void
+check_functions (uint8_t *a, uint8_t *b)
+{
+  size_t size, ofs_a, ofs_b, i;
+
+  for (size = 0; size < CHECK_SIZE; size += size < 80 ? 1 : 67)
+    for (ofs_a = 0; ofs_a < 4; ofs_a++)
+      for (ofs_b = 0; ofs_b < 4; ofs_b++)
+        {
+          uint8_t *dst = a + ofs_a;
+          uint8_t *src = b + ofs_b;
+
+          /* memcpy() copies exactly SIZE bytes. */
+          fill (a, CHECK_SIZE + 8, 1);
+          fill (b, CHECK_SIZE + 8, 2);
+          ASSERT (memcpy (dst, src, size) == dst);
+          for (i = 0; i < CHECK_SIZE + 8; i++)
+            ASSERT (a[i] == (a + i >= dst && a + i < dst + size
+                             ? src[a + i - dst] : (uint8_t) ((i * 31 + 1) >> 3)));
+
+          /* memcmp() finds the first difference. */
+          ASSERT (memcmp (dst, src, size) == 0);
+          if (size > 0)
+            {
+              size_t at = size * 7 / 11;
+              uint8_t byte = dst[at];
+
+              dst[at] = 1;
+              src[at] = 0;
+              ASSERT (memcmp (dst, src, size) > 0);
+              ASSERT (memcmp (src, dst, size) < 0);
+              dst[at] = src[at] = byte;
+            }
+
+          /* memset() sets exactly SIZE bytes. */
+          ASSERT (memset (dst, 0xa5, size) == dst);
+          for (i = 0; i < CHECK_SIZE + 8; i++)
+            ASSERT (a[i] == (a + i >= dst && a + i < dst + size
+                             ? 0xa5 : (uint8_t) ((i * 31 + 1) >> 3)));
+        }
+
+  /* memmove() handles overlap in both directions. */
+  for (size = 1; size < CHECK_SIZE; size += 97)
+    for (ofs_a = 1; ofs_a < 6; ofs_a++)
+      {
+        fill (a, CHECK_SIZE + 8, 3);
+        ASSERT (memmove (a + ofs_a, a, size) == a + ofs_a);
+        for (i = 0; i < size; i++)
+          ASSERT (a[ofs_a + i] == (uint8_t) ((i * 31 + 3) >> 3));
+
+        fill (a, CHECK_SIZE + 8, 3);
+        ASSERT (memmove (a, a + ofs_a, size) == a);
+        for (i = 0; i < size; i++)
+          ASSERT (a[i] == (uint8_t) (((i + ofs_a) * 31 + 3) >> 3));
+      }
+}
+
+/* Times memcpy(), memset() and memcmp() on blocks of BLOCK bytes
+   in A and B. */
+static void
+time_functions (uint8_t *a, uint8_t *b, size_t block)
+{
+  size_t reps = BYTE_CNT / block;
+  int64_t start;
+  uint64_t cycles;
+  size_t i;
+  int sum = 0;
+
+  start = timer_ticks ();
+  cycles = rdtsc ();
+  for (i = 0; i < reps; i++)
+    memcpy (a, b, block);
+  report ("memcpy", block, start, rdtsc () - cycles);
+
+  start = timer_ticks ();
+  cycles = rdtsc ();
+  for (i = 0; i < reps; i++)
+    memset (a, i, block);
+  report ("memset", block, start, rdtsc () - cycles);
+
+  memset (b, (reps - 1) & 0xff, block);
+  start = timer_ticks ();
+  cycles = rdtsc ();
+  for (i = 0; i < reps; i++)
+    sum += memcmp (a, b, block);
+  report ("memcmp", block, start, rdtsc () - cycles);
+  ASSERT (sum == 0);
+}
+
+/* Prints the bandwidth of BYTE_CNT bytes processed in blocks of
+   BLOCK bytes by the function named NAME, which began at timer
+   tick START and took CYCLES cycles. */
+static void
+report (const char *name, size_t block, int64_t start, uint64_t cycles)
+{
+  int64_t ticks = timer_elapsed (start);
+
+  if (ticks == 0)
+    ticks = 1;
+  printf ("%s%s, %zu-byte blocks: %"PRId64" MB/s, %"PRIu64" cycles/kB\n",
+          name, string_sse2 ? " (SSE2)" : "", block,
+          (int64_t) BYTE_CNT / (1024 * 1024) * TIMER_FREQ / ticks,
+          cycles / (BYTE_CNT / 1024));
+}
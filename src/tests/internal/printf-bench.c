@@ -0,0 +1,131 @@
+/* Throughput benchmark for printf() and the console.
+
+   Prints LINE_CNT lines of typical log output, each with a few
+   decimal, hexadecimal and 64-bit conversions, three ways, and
+   reports lines per second and cycles per line, by the
+   processor's time-stamp counter, for each:
+
+     - formatting only, with snprintf() into a buffer;
+
+     - printf(), which formats into a buffer and writes it to
+       the console in one piece;
+
+     - formatting with snprintf() and then writing the line with
+       putchar() one character at a time, as printf() used to.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Number of lines printed for each way. */
+#define LINE_CNT 100000
+
+/* Format and arguments of log line number LINE. */
+#define LINE_FORMAT \
+        "line %d: sector %"PRIu32" at %#"PRIx32", %"PRId64" ticks, %s\n"
+#define LINE_ARGS(LINE)                                         \
+        (LINE), (uint32_t) (LINE) * 2654435761u,                \
+        (uint32_t) (LINE) * 4096, (int64_t) (LINE) * 1000003,   \
+        (LINE) % 2 ? "ok" : "retry"
+
+/* How to print the lines. */
+enum way
+  {
+    FORMAT_ONLY,                /* snprintf() into a buffer. */
+    PRINTF,                     /* printf(). */
+    PUTCHAR                     /* snprintf() then putchar(). */
+  };
+
+static void time_lines (const char *name, enum way);
+static int format_line (char *, size_t, int line);
+
+/* Returns the processor's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Times each way of printing. */
+void
+test (void)
+{
+  char buf[128];
+
+  format_line (buf, sizeof buf, 12345);
+  ASSERT (!strcmp (buf, "line 12345: sector 2703968361 at 0x3039000, "
+                   "12345037035 ticks, ok\n"));
+  format_line (buf, sizeof buf, 7000000);
+  ASSERT (!strcmp (buf, "line 7000000: sector 3897254848 at 0xacfc0000, "
+                   "7000021000000 ticks, retry\n"));
+
+  time_lines ("format only", FORMAT_ONLY);
+  time_lines ("printf", PRINTF);
+  time_lines ("putchar", PUTCHAR);
+
+  printf ("printf-bench: PASS\n");
+}
+
+/* Formats log line number LINE into the SIZE bytes at BUF and
+   returns its length. */
+static int
+format_line (char *buf, size_t size, int line)
+{
+  return snprintf (buf, size, LINE_FORMAT, LINE_ARGS (line));
+}
+
+/* Prints LINE_CNT lines the given WAY and reports the results
+   under NAME. */
+static void
+time_lines (const char *name, enum way way)
+{
+  char buf[128];
+  int64_t start, ticks;
+  uint64_t cycles;
+  size_t char_cnt = 0;
+  int line;
+
+  start = timer_ticks ();
+  cycles = rdtsc ();
+  for (line = 0; line < LINE_CNT; line++)
+    switch (way)
+      {
+      case FORMAT_ONLY:
+        char_cnt += format_line (buf, sizeof buf, line);
+        break;
+
+      case PRINTF:
+        char_cnt += printf (LINE_FORMAT, LINE_ARGS (line));
+        break;
+
+      case PUTCHAR:
+        {
+          int len = format_line (buf, sizeof buf, line);
+          int i;
+
+          for (i = 0; i < len; i++)
+            putchar (buf[i]);
+          char_cnt += len;
+        }
+        break;
+      }
+  cycles = rdtsc () - cycles;
+  ticks = timer_elapsed (start);
+
+  if (ticks == 0)
+    ticks = 1;
+  printf ("%s: %zu characters, %"PRId64" lines per second, "
+          "%"PRIu64" cycles per line\n",
+          name, char_cnt, (int64_t) LINE_CNT * TIMER_FREQ / ticks,
+          cycles / LINE_CNT);
+}
@@ -0,0 +1,237 @@
+/* Throughput benchmark for queued block requests.
+
+   Writes and then reads the first SPAN_SIZE bytes of the scratch
+   device in REQUEST-sector requests, first one at a time with
+   block_write_multi() and block_read_multi(), and then with
+   DEPTH requests queued at once with block_submit().  The queued
+   writes are resubmitted by their completion functions, from the
+   interrupt handler; the queued reads are waited for with
+   block_wait() and resubmitted by the test thread.  Reports for
+   each the throughput and the CPU time consumed per megabyte
+   transferred, as dma-bench does, so nothing else should be
+   running.  Checks that the data read back is what was written.
+   Overwrites the start of the scratch device.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/test.h"
+#include "threads/thread.h"
+
+/* Bytes written and read each way. */
+#define SPAN_SIZE (16 * 1024 * 1024)
+#define SPAN_SECTORS (SPAN_SIZE / BLOCK_SECTOR_SIZE)
+
+/* Sectors per request. */
+#define REQUEST 64
+#define REQUEST_SIZE (REQUEST * BLOCK_SECTOR_SIZE)
+
+/* Number of requests queued at once. */
+#define DEPTH 8
+
+/* State shared by the queued writes. */
+struct writer
+  {
+    struct block *block;        /* Device written. */
+    block_sector_t next;        /* Next sector to write. */
+    int pending;                /* Requests not yet finished. */
+    struct semaphore done;      /* Up'd when all have finished. */
+  };
+
+static struct block_request requests[DEPTH];
+static uint8_t *buffers[DEPTH];
+
+static void fill (uint8_t *);
+static void check (const uint8_t *);
+static void sync_span (struct block *);
+static void queued_span (struct block *);
+static void report (const char *op, const char *how,
+                    int64_t start, int64_t idle_start);
+
+/* Times transfers one request at a time and queued. */
+void
+test (void)
+{
+  struct block *scratch = block_get_role (BLOCK_SCRATCH);
+  int i;
+
+  ASSERT (scratch != NULL);
+  ASSERT (block_size (scratch) >= SPAN_SECTORS);
+  for (i = 0; i < DEPTH; i++)
+    {
+      buffers[i] = malloc (REQUEST_SIZE);
+      ASSERT (buffers[i] != NULL);
+    }
+
+  sync_span (scratch);
+  queued_span (scratch);
+
+  for (i = 0; i < DEPTH; i++)
+    free (buffers[i]);
+  printf ("queue-bench: PASS\n");
+}
+
+/* Returns the byte at offset OFS in the data written by each
+   request. */
+static uint8_t
+pattern (size_t ofs)
+{
+  return (ofs / BLOCK_SECTOR_SIZE) * 13 + ofs % 241;
+}
+
+/* Fills BUF, which holds REQUEST_SIZE bytes, with the data
+   written by each request. */
+static void
+fill (uint8_t *buf)
+{
+  size_t i;
+
+  for (i = 0; i < REQUEST_SIZE; i++)
+    buf[i] = pattern (i);
+}
+
+/* Checks that BUF, which holds REQUEST_SIZE bytes, holds the data
+   written by each request. */
+static void
+check (const uint8_t *buf)
+{
+  size_t i;
+
+  for (i = 0; i < REQUEST_SIZE; i++)
+    ASSERT (buf[i] == pattern (i));
+}
+
+/* Writes and then reads SPAN_SECTORS sectors of SCRATCH, one
+   request at a time. */
+static void
+sync_span (struct block *scratch)
+{
+  block_sector_t sector;
+  int64_t start, idle_start;
+
+  fill (buffers[0]);
+  start = timer_ticks ();
+  idle_start = thread_idle_ticks ();
+  for (sector = 0; sector < SPAN_SECTORS; sector += REQUEST)
+    block_write_multi (scratch, sector, REQUEST, buffers[0]);
+  report ("write", "one at a time", start, idle_start);
+
+  start = timer_ticks ();
+  idle_start = thread_idle_ticks ();
+  for (sector = 0; sector < SPAN_SECTORS; sector += REQUEST)
+    block_read_multi (scratch, sector, REQUEST, buffers[1]);
+  report ("read", "one at a time", start, idle_start);
+
+  /* Every request wrote the same data, so the last one read
+     should have read it back. */
+  check (buffers[1]);
+}
+
+/* Completion function for the queued writes: submits R again for
+   the next REQUEST sectors, if any remain, and otherwise wakes
+   up the test thread once the last write has finished.  Runs in
+   the interrupt handler. */
+static void
+write_done (struct block_request *r)
+{
+  struct writer *w = r->aux;
+
+  if (w->next < SPAN_SECTORS)
+    {
+      block_request_init (r, true, w->next, REQUEST, r->buffer,
+                          write_done, w);
+      w->next += REQUEST;
+      block_submit (w->block, r);
+    }
+  else if (--w->pending == 0)
+    sema_up (&w->done);
+}
+
+/* Writes and then reads SPAN_SECTORS sectors of SCRATCH, DEPTH
+   requests at a time. */
+static void
+queued_span (struct block *scratch)
+{
+  struct writer w;
+  enum intr_level old_level;
+  size_t req_cnt = SPAN_SECTORS / REQUEST;
+  size_t i;
+  int64_t start, idle_start;
+
+  ASSERT (req_cnt >= DEPTH);
+
+  /* Write.  Every request writes the same data, from buffers[0].
+     Interrupts are off while the first requests are submitted,
+     since their completion functions update W too. */
+  fill (buffers[0]);
+  w.block = scratch;
+  w.next = 0;
+  w.pending = DEPTH;
+  sema_init (&w.done, 0);
+  start = timer_ticks ();
+  idle_start = thread_idle_ticks ();
+  old_level = intr_disable ();
+  for (i = 0; i < DEPTH; i++)
+    {
+      block_request_init (&requests[i], true, w.next, REQUEST, buffers[0],
+                          write_done, &w);
+      w.next += REQUEST;
+      block_submit (scratch, &requests[i]);
+    }
+  intr_set_level (old_level);
+  sema_down (&w.done);
+  report ("write", "queued", start, idle_start);
+
+  /* Read.  Request I reuses the slot and buffer of request
+     I - DEPTH, after waiting for it. */
+  for (i = 0; i < DEPTH; i++)
+    buffers[i][0] = ~pattern (0);
+  start = timer_ticks ();
+  idle_start = thread_idle_ticks ();
+  for (i = 0; i < req_cnt + DEPTH; i++)
+    {
+      struct block_request *r = &requests[i % DEPTH];
+
+      if (i >= DEPTH)
+        block_wait (r);
+      if (i < req_cnt)
+        {
+          block_request_init (r, false, i * REQUEST, REQUEST,
+                              buffers[i % DEPTH], NULL, NULL);
+          block_submit (scratch, r);
+        }
+    }
+  report ("read", "queued", start, idle_start);
+
+  for (i = 0; i < DEPTH; i++)
+    check (buffers[i]);
+}
+
+/* Prints the throughput and CPU time per megabyte of SPAN_SIZE
+   bytes transferred by the operation named OP, done the way
+   named HOW, which began at timer tick START, when the idle
+   thread had run for IDLE_START ticks. */
+static void
+report (const char *op, const char *how, int64_t start, int64_t idle_start)
+{
+  int64_t ticks = timer_elapsed (start);
+  int64_t busy = ticks - (thread_idle_ticks () - idle_start);
+  int mb = SPAN_SIZE / (1024 * 1024);
+
+  if (ticks == 0)
+    ticks = 1;
+  printf ("%s, %s: %"PRId64" kB/s, %"PRId64" ms of CPU per MB "
+          "(%"PRId64" of %"PRId64" ticks busy)\n",
+          op, how, (int64_t) SPAN_SIZE / 1024 * TIMER_FREQ / ticks,
+          busy * 1000 / TIMER_FREQ / mb, busy, ticks);
+}
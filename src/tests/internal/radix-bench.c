@@ -0,0 +1,199 @@
+/* Throughput benchmark comparing lib/kernel/radix.c against
+   lib/kernel/hash.c as an index of the pages of a file.
+
+   For several file sizes, maps each page number to a page
+   structure in a radix tree and in a hash table, and times, by
+   the processor's time-stamp counter, inserting every page,
+   LOOKUP_CNT lookups of random pages, scanning every range of
+   RANGE_PAGES pages in turn, as writing back or truncating part
+   of a file would, and deleting every page.  Reports the
+   operations per second and the cycles per operation of each
+   structure.  The hash table has no order, so it scans a range
+   with one lookup per page number in it; the tree visits each
+   range in one pass over a handful of leaf nodes.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <radix.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Number of lookups timed for each structure and size. */
+#define LOOKUP_CNT 200000
+
+/* Pages in each range scanned. */
+#define RANGE_PAGES 64
+
+/* Largest number of pages. */
+#define MAX_PAGE_CNT 16384
+
+/* A page of a file. */
+struct page
+  {
+    struct hash_elem hash_elem;         /* Hash table element. */
+    unsigned long index;                /* Page number in file. */
+  };
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static void time_ops (const char *name, bool use_radix,
+                      struct radix_tree *, struct hash *,
+                      struct page *, int page_cnt);
+static void report (const char *name, const char *op, int op_cnt,
+                    int64_t start, uint64_t cycles);
+
+/* Returns the processor's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Compares radix trees and hash tables of several sizes. */
+void
+test (void)
+{
+  static const int page_cnts[] = {1024, 4096, MAX_PAGE_CNT};
+  struct page *pages = malloc (MAX_PAGE_CNT * sizeof *pages);
+  size_t i;
+
+  ASSERT (pages != NULL);
+  for (i = 0; i < sizeof page_cnts / sizeof *page_cnts; i++)
+    {
+      struct radix_tree tree;
+      struct hash hash;
+      int j;
+
+      for (j = 0; j < page_cnts[i]; j++)
+        pages[j].index = j;
+
+      radix_init (&tree);
+      time_ops ("radix", true, &tree, NULL, pages, page_cnts[i]);
+      ASSERT (hash_init (&hash, page_hash, page_less, NULL));
+      time_ops ("hash", false, NULL, &hash, pages, page_cnts[i]);
+      hash_destroy (&hash, NULL);
+    }
+  free (pages);
+
+  printf ("radix-bench: PASS\n");
+}
+
+/* Times inserts, lookups, range scans and deletes of the
+   PAGE_CNT pages in PAGES, in TREE if USE_RADIX is true or in
+   HASH otherwise, and prints the results under NAME. */
+static void
+time_ops (const char *name, bool use_radix, struct radix_tree *tree,
+          struct hash *hash, struct page *pages, int page_cnt)
+{
+  struct page key;
+  unsigned x = 1;
+  int found, i;
+  int64_t start;
+  uint64_t cycles;
+
+  printf ("%s, %d pages:\n", name, page_cnt);
+
+  /* Insert every page. */
+  start = timer_ticks ();
+  cycles = rdtsc ();
+  for (i = 0; i < page_cnt; i++)
+    {
+      if (use_radix)
+        found = radix_insert (tree, pages[i].index, &pages[i]) == NULL;
+      else
+        found = hash_insert (hash, &pages[i].hash_elem) == NULL;
+      ASSERT (found);
+    }
+  report (name, "inserts", page_cnt, start, rdtsc () - cycles);
+
+  /* Look up random pages. */
+  found = 0;
+  start = timer_ticks ();
+  cycles = rdtsc ();
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      x = x * 1103515245 + 12345;
+      key.index = (x >> 8) % page_cnt;
+      if (use_radix
+          ? radix_lookup (tree, key.index) != NULL
+          : hash_find (hash, &key.hash_elem) != NULL)
+        found++;
+    }
+  report (name, "lookups", LOOKUP_CNT, start, rdtsc () - cycles);
+  ASSERT (found == LOOKUP_CNT);
+
+  /* Visit every page, a range at a time. */
+  found = 0;
+  start = timer_ticks ();
+  cycles = rdtsc ();
+  for (i = 0; i < page_cnt; i += RANGE_PAGES)
+    if (use_radix)
+      {
+        struct radix_iterator it;
+
+        radix_first (&it, tree, i, i + RANGE_PAGES - 1);
+        while (radix_next (&it) != NULL)
+          found++;
+      }
+    else
+      for (key.index = i; key.index < (unsigned long) i + RANGE_PAGES;
+           key.index++)
+        if (hash_find (hash, &key.hash_elem) != NULL)
+          found++;
+  report (name, "range scans", page_cnt / RANGE_PAGES, start,
+          rdtsc () - cycles);
+  ASSERT (found == page_cnt);
+
+  /* Delete every page. */
+  start = timer_ticks ();
+  cycles = rdtsc ();
+  for (i = 0; i < page_cnt; i++)
+    {
+      if (use_radix)
+        found = radix_delete (tree, pages[i].index) == &pages[i];
+      else
+        found = hash_delete (hash, &pages[i].hash_elem) != NULL;
+      ASSERT (found);
+    }
+  report (name, "deletes", page_cnt, start, rdtsc () - cycles);
+}
+
+/* Prints the rate of OP_CNT operations named OP that began at
+   timer tick START and took CYCLES cycles. */
+static void
+report (const char *name, const char *op, int op_cnt, int64_t start,
+        uint64_t cycles)
+{
+  int64_t ticks = timer_elapsed (start);
+
+  if (ticks == 0)
+    ticks = 1;
+  printf ("  %s %s: %"PRId64" per second, %"PRIu64" cycles each\n",
+          name, op, (int64_t) op_cnt * TIMER_FREQ / ticks, cycles / op_cnt);
+}
+
+/* Returns a hash value for the page that contains E. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct page, hash_elem)->index);
+}
+
+/* Returns true if page A's index is less than B's. */
+static bool
+page_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED)
+{
+  return (hash_entry (a, struct page, hash_elem)->index
+          < hash_entry (b, struct page, hash_elem)->index);
+}
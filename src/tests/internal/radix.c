@@ -0,0 +1,337 @@
+/* Test program for lib/kernel/radix.c.
+
+   Inserts items at a mix of dense and sparse indexes, including
+   the largest ones, in random order, and checks lookups, tags,
+   gang lookups and range iteration against a simple array of
+   what the tree should hold, as items are deleted in random
+   order and by ranges.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <limits.h>
+#include <radix.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Number of items. */
+#define ITEM_CNT 1024
+
+/* Number of rounds of the whole test. */
+#define ROUND_CNT 8
+
+/* An item, and what the tree should say about it. */
+struct item
+  {
+    unsigned long index;                /* Index in tree. */
+    bool present;                       /* In tree? */
+    bool tags[RADIX_TAG_CNT];           /* Tags set? */
+  };
+
+/* Items, in increasing order of index. */
+static struct item items[ITEM_CNT];
+
+static void make_indexes (void);
+static void shuffle (struct item *[], size_t);
+static void verify_tree (struct radix_tree *);
+static void verify_gang (struct radix_tree *, unsigned long first, int tag);
+static void verify_range (struct radix_tree *, unsigned long first,
+                          unsigned long last, int tag);
+static bool matches (const struct item *, int tag);
+static size_t lower_bound (unsigned long index);
+static radix_action_func count_item;
+
+/* Number of calls to count_item(). */
+static size_t destroyed_cnt;
+
+/* Tests the radix tree implementation. */
+void
+test (void)
+{
+  static struct item *order[ITEM_CNT];
+  int round;
+
+  printf ("testing radix trees:");
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      struct radix_tree tree;
+      struct radix_iterator it;
+      struct item *item;
+      unsigned long first, last;
+      size_t i;
+      int tag;
+
+      printf (" %d", round);
+      make_indexes ();
+      radix_init (&tree);
+      ASSERT (radix_empty (&tree));
+      ASSERT (radix_lookup (&tree, 0) == NULL);
+      verify_range (&tree, 0, ULONG_MAX, -1);
+
+      /* Insert every item in random order, and check that
+         inserting again finds the first. */
+      for (i = 0; i < ITEM_CNT; i++)
+        order[i] = &items[i];
+      shuffle (order, ITEM_CNT);
+      for (i = 0; i < ITEM_CNT; i++)
+        {
+          ASSERT (radix_insert (&tree, order[i]->index, order[i]) == NULL);
+          order[i]->present = true;
+          ASSERT (radix_insert (&tree, order[i]->index, &items[0])
+                  == order[i]);
+          if (i % 64 == 0)
+            verify_tree (&tree);
+        }
+      verify_tree (&tree);
+
+      /* Tag items at random. */
+      for (i = 0; i < ITEM_CNT; i++)
+        for (tag = 0; tag < RADIX_TAG_CNT; tag++)
+          if (random_ulong () % 4 == 0)
+            {
+              ASSERT (radix_tag_set (&tree, items[i].index, tag)
+                      == &items[i]);
+              items[i].tags[tag] = true;
+            }
+      verify_tree (&tree);
+
+      /* Untag some of them again. */
+      for (i = 0; i < ITEM_CNT; i++)
+        for (tag = 0; tag < RADIX_TAG_CNT; tag++)
+          if (items[i].tags[tag] && random_ulong () % 2 == 0)
+            {
+              ASSERT (radix_tag_clear (&tree, items[i].index, tag)
+                      == &items[i]);
+              items[i].tags[tag] = false;
+            }
+      verify_tree (&tree);
+
+      /* Delete half the items in random order. */
+      shuffle (order, ITEM_CNT);
+      for (i = 0; i < ITEM_CNT / 2; i++)
+        {
+          ASSERT (radix_delete (&tree, order[i]->index) == order[i]);
+          ASSERT (radix_delete (&tree, order[i]->index) == NULL);
+          ASSERT (radix_tag_set (&tree, order[i]->index, 0) == NULL);
+          order[i]->present = false;
+          if (i % 64 == 0)
+            verify_tree (&tree);
+        }
+      verify_tree (&tree);
+
+      /* Delete a range of items while iterating over it, as
+         truncating a file would. */
+      first = items[ITEM_CNT / 4].index;
+      last = items[ITEM_CNT / 2].index;
+      radix_first (&it, &tree, first, last);
+      while ((item = radix_next (&it)) != NULL)
+        {
+          ASSERT (item->index == it.index);
+          ASSERT (radix_delete (&tree, it.index) == item);
+          item->present = false;
+        }
+      verify_tree (&tree);
+
+      /* Tear down the rest. */
+      destroyed_cnt = 0;
+      i = radix_size (&tree);
+      radix_destroy (&tree, count_item);
+      ASSERT (destroyed_cnt == i);
+      ASSERT (radix_empty (&tree));
+      ASSERT (tree.root == NULL);
+    }
+
+  printf (" done\n");
+  printf ("radix: PASS\n");
+}
+
+/* Chooses ITEM_CNT indexes for ITEMS, in increasing order: runs
+   of consecutive indexes, like the pages of a file, separated by
+   gaps of random size, with the last few items at the very top
+   of the index space. */
+static void
+make_indexes (void)
+{
+  unsigned long index = 0;
+  size_t i;
+
+  for (i = 0; i < ITEM_CNT - 4; i++)
+    {
+      if (random_ulong () % 8 == 0)
+        index += random_ulong () % 5000;
+      items[i].index = index++;
+    }
+  for (; i < ITEM_CNT; i++)
+    items[i].index = ULONG_MAX - (ITEM_CNT - 1 - i) * 3;
+
+  for (i = 0; i < ITEM_CNT; i++)
+    {
+      int tag;
+
+      items[i].present = false;
+      for (tag = 0; tag < RADIX_TAG_CNT; tag++)
+        items[i].tags[tag] = false;
+    }
+}
+
+/* Shuffles the CNT pointers in ARRAY into random order. */
+static void
+shuffle (struct item **array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct item *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Verifies that TREE holds exactly the items marked present,
+   with the right tags, and that gang lookups and iteration over
+   a few ranges find them. */
+static void
+verify_tree (struct radix_tree *tree)
+{
+  size_t present_cnt = 0;
+  size_t tagged_cnt[RADIX_TAG_CNT];
+  size_t i;
+  int tag, j;
+
+  for (tag = 0; tag < RADIX_TAG_CNT; tag++)
+    tagged_cnt[tag] = 0;
+  for (i = 0; i < ITEM_CNT; i++)
+    {
+      struct item *item = &items[i];
+
+      ASSERT (radix_lookup (tree, item->index)
+              == (item->present ? item : NULL));
+      ASSERT (item->index == ULONG_MAX
+              || radix_lookup (tree, item->index + 1) == NULL
+              || (i + 1 < ITEM_CNT && items[i + 1].index == item->index + 1));
+      for (tag = 0; tag < RADIX_TAG_CNT; tag++)
+        {
+          bool tagged = item->present && item->tags[tag];
+          ASSERT (radix_tag_get (tree, item->index, tag) == tagged);
+          tagged_cnt[tag] += tagged;
+        }
+      present_cnt += item->present;
+    }
+  ASSERT (radix_size (tree) == present_cnt);
+  ASSERT (radix_empty (tree) == (present_cnt == 0));
+  for (tag = 0; tag < RADIX_TAG_CNT; tag++)
+    ASSERT (radix_tagged (tree, tag) == (tagged_cnt[tag] > 0));
+
+  for (j = 0; j < 4; j++)
+    {
+      unsigned long a = items[random_ulong () % ITEM_CNT].index;
+      unsigned long b = a + random_ulong () % 20000;
+
+      if (b < a)
+        b = ULONG_MAX;
+      for (tag = -1; tag < RADIX_TAG_CNT; tag++)
+        {
+          verify_gang (tree, a - random_ulong () % 2, tag);
+          verify_range (tree, a, b, tag);
+        }
+    }
+  for (tag = -1; tag < RADIX_TAG_CNT; tag++)
+    {
+      verify_gang (tree, 0, tag);
+      verify_range (tree, 0, ULONG_MAX, tag);
+      verify_range (tree, ULONG_MAX, ULONG_MAX, tag);
+    }
+}
+
+/* Returns true if ITEM should be found by a lookup for TAG, or
+   for any item if TAG is -1. */
+static bool
+matches (const struct item *item, int tag)
+{
+  return item->present && (tag < 0 || item->tags[tag]);
+}
+
+/* Verifies a gang lookup in TREE from FIRST for TAG, or for any
+   item if TAG is -1. */
+static void
+verify_gang (struct radix_tree *tree, unsigned long first, int tag)
+{
+  void *found[16];
+  unsigned long indexes[16];
+  size_t max_cnt = random_ulong () % 16 + 1;
+  size_t cnt, i, j;
+
+  cnt = (tag < 0
+         ? radix_gang_lookup (tree, first, found, indexes, max_cnt)
+         : radix_gang_lookup_tag (tree, first, found, indexes, max_cnt, tag));
+  ASSERT (cnt <= max_cnt);
+
+  for (i = lower_bound (first), j = 0; i < ITEM_CNT && j < max_cnt; i++)
+    if (matches (&items[i], tag))
+      {
+        ASSERT (j < cnt);
+        ASSERT (found[j] == &items[i]);
+        ASSERT (indexes[j] == items[i].index);
+        j++;
+      }
+  ASSERT (j == cnt);
+}
+
+/* Verifies iteration over indexes FIRST...LAST in TREE for TAG,
+   or for any item if TAG is -1. */
+static void
+verify_range (struct radix_tree *tree, unsigned long first,
+              unsigned long last, int tag)
+{
+  struct radix_iterator it;
+  struct item *item;
+  size_t i = lower_bound (first);
+
+  if (tag < 0)
+    radix_first (&it, tree, first, last);
+  else
+    radix_first_tag (&it, tree, first, last, tag);
+  while ((item = radix_next (&it)) != NULL)
+    {
+      while (i < ITEM_CNT && !matches (&items[i], tag))
+        i++;
+      ASSERT (i < ITEM_CNT);
+      ASSERT (item == &items[i]);
+      ASSERT (it.index == item->index);
+      ASSERT (item->index >= first && item->index <= last);
+      i++;
+    }
+  for (; i < ITEM_CNT && items[i].index <= last; i++)
+    ASSERT (!matches (&items[i], tag));
+  ASSERT (radix_next (&it) == NULL);
+}
+
+/* Returns the position in ITEMS of the first item whose index is
+   INDEX or greater. */
+static size_t
+lower_bound (unsigned long index)
+{
+  size_t i;
+
+  for (i = 0; i < ITEM_CNT && items[i].index < index; i++)
+    continue;
+  return i;
+}
+
+/* Counts ITEM, which must be present at INDEX, for
+   radix_destroy(). */
+static void
+count_item (unsigned long index, void *item_)
+{
+  struct item *item = item_;
+
+  ASSERT (item->present);
+  ASSERT (item->index == index);
+  destroyed_cnt++;
+}
@@ -0,0 +1,198 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Builds trees of various sizes from values in random order,
+   checks that they come back out in order and that the
+   red-black invariants hold, then removes the values in random
+   order, checking again after every removal.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a tree that we will test. */
+#define MAX_SIZE 128
+
+/* A tree element. */
+struct value
+  {
+    struct rb_node node;        /* Tree node. */
+    int value;                  /* Item value. */
+    int seq;                    /* Order of insertion. */
+  };
+
+static void shuffle (struct value *[], size_t);
+static bool value_less (const struct rb_node *, const struct rb_node *,
+                        void *);
+static void verify_tree (struct rb_tree *, int size);
+static int verify_subtree (struct rb_node *, struct rb_node *parent);
+
+/* Tests the red-black tree implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size trees:");
+  for (size = 0; size < MAX_SIZE; size++)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE * 2];
+          static struct value *order[MAX_SIZE * 2];
+          struct rb_tree tree;
+          struct rb_node *n;
+          struct value key;
+          int i;
+
+          /* Insert values 0...SIZE in random order and verify. */
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = i;
+              order[i] = &values[i];
+            }
+          shuffle (order, size);
+          rb_init (&tree, value_less, NULL);
+          for (i = 0; i < size; i++)
+            rb_insert (&tree, &order[i]->node);
+          verify_tree (&tree, size);
+
+          /* Look up every value, and one past the end. */
+          for (i = 0; i <= size; i++)
+            {
+              key.value = i;
+              n = rb_find (&tree, &key.node);
+              ASSERT (i < size
+                      ? rb_entry (n, struct value, node)->value == i
+                      : n == NULL);
+            }
+
+          /* Insert a copy of each value and check that copies
+             come out after the originals, in insertion order. */
+          for (i = 0; i < size; i++)
+            {
+              values[i].seq = 0;
+              values[size + i].value = values[i].value;
+              values[size + i].seq = 1;
+              rb_insert (&tree, &values[size + i].node);
+            }
+          ASSERT (rb_size (&tree) == (size_t) size * 2);
+          for (i = 0, n = rb_min (&tree); n != NULL; i++, n = rb_next (n))
+            {
+              struct value *v = rb_entry (n, struct value, node);
+              ASSERT (v->value == i / 2);
+              ASSERT (v->seq == i % 2);
+            }
+          ASSERT (i == size * 2);
+          for (i = 0; i < size; i++)
+            {
+              key.value = i;
+              n = rb_find (&tree, &key.node);
+              ASSERT (rb_entry (n, struct value, node)->seq == 0);
+            }
+
+          /* Remove everything in random order, verifying as we
+             go. */
+          for (i = 0; i < size * 2; i++)
+            order[i] = &values[i];
+          shuffle (order, size * 2);
+          for (i = 0; i < size * 2; i++)
+            {
+              rb_remove (&tree, &order[i]->node);
+              ASSERT (rb_size (&tree) == (size_t) (size * 2 - i - 1));
+              verify_subtree (tree.root, NULL);
+            }
+          ASSERT (rb_empty (&tree));
+          ASSERT (rb_min (&tree) == NULL);
+        }
+    }
+
+  printf (" done\n");
+  printf ("rbtree: PASS\n");
+}
+
+/* Shuffles the CNT pointers in ARRAY into random order.  The
+   values themselves stay put, because they may be linked into a
+   tree. */
+static void
+shuffle (struct value **array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct rb_node *a_, const struct rb_node *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = rb_entry (a_, struct value, node);
+  const struct value *b = rb_entry (b_, struct value, node);
+
+  return a->value < b->value;
+}
+
+/* Verifies that TREE is a valid red-black tree that contains the
+   values 0...SIZE, in order both forward and backward. */
+static void
+verify_tree (struct rb_tree *tree, int size)
+{
+  struct rb_node *n;
+  int i;
+
+  verify_subtree (tree->root, NULL);
+  ASSERT (rb_size (tree) == (size_t) size);
+  ASSERT (rb_empty (tree) == (size == 0));
+
+  for (i = 0, n = rb_min (tree); i < size && n != NULL;
+       i++, n = rb_next (n))
+    ASSERT (rb_entry (n, struct value, node)->value == i);
+  ASSERT (i == size);
+  ASSERT (n == NULL);
+
+  for (i = size - 1, n = rb_max (tree); i >= 0 && n != NULL;
+       i--, n = rb_prev (n))
+    ASSERT (rb_entry (n, struct value, node)->value == i);
+  ASSERT (i == -1);
+  ASSERT (n == NULL);
+}
+
+/* Verifies that N, whose parent should be PARENT, roots a valid
+   red-black subtree, and returns the number of black nodes on
+   each of its paths.  A red node must not have a red parent, and
+   the root of a whole tree must be black. */
+static int
+verify_subtree (struct rb_node *n, struct rb_node *parent)
+{
+  int left, right;
+
+  if (n == NULL)
+    return 1;
+
+  ASSERT (n->parent == parent);
+  ASSERT (!n->red || (parent != NULL && !parent->red));
+  ASSERT (n->left == NULL || !value_less (n, n->left, NULL));
+  ASSERT (n->right == NULL || !value_less (n->right, n, NULL));
+
+  left = verify_subtree (n->left, n);
+  right = verify_subtree (n->right, n);
+  ASSERT (left == right);
+  return left + !n->red;
+}
@@ -0,0 +1,137 @@
+/* Concurrent read benchmark for the file system's locking.
+
+   Starts 1, 2, 4 and 8 threads, each of which opens a file of its
+   own and reads all of it ROUND_CNT times, and reports how long
+   each group of threads takes in total, first with every thread
+   reading the same file and then with each reading a different
+   one.  Readers never hold a lock that excludes other readers
+   while they wait for the disk, so the time per byte read should
+   fall or stay level as threads are added, rather than grow as
+   it would if reads were serialized.
+
+   Kernel threads stand in for user processes here, which cannot
+   time themselves.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/test.h"
+
+/* Largest number of reader threads. */
+#define THREAD_MAX 8
+
+/* Size of each file, in bytes. */
+#define FILE_SIZE (64 * 1024)
+
+/* Bytes read at a time. */
+#define CHUNK_SIZE 4096
+
+/* Number of times each thread reads its file. */
+#define ROUND_CNT 8
+
+/* A reader thread's work. */
+struct reader
+  {
+    char name[16];                      /* File to read. */
+    struct semaphore *done;             /* Upped when finished. */
+  };
+
+static void reader_thread (void *);
+static void run (int thread_cnt, bool shared);
+
+/* Times concurrent readers. */
+void
+test (void)
+{
+  static uint8_t buf[FILE_SIZE];
+  char name[16];
+  int i, thread_cnt;
+
+  for (i = 0; i < THREAD_MAX; i++)
+    {
+      struct file *file;
+
+      snprintf (name, sizeof name, "read%d", i);
+      ASSERT (filesys_create (name, 0));
+      file = filesys_open (name);
+      ASSERT (file != NULL);
+      ASSERT (file_write (file, buf, sizeof buf) == sizeof buf);
+      file_close (file);
+    }
+
+  for (thread_cnt = 1; thread_cnt <= THREAD_MAX; thread_cnt *= 2)
+    run (thread_cnt, true);
+  for (thread_cnt = 1; thread_cnt <= THREAD_MAX; thread_cnt *= 2)
+    run (thread_cnt, false);
+
+  for (i = 0; i < THREAD_MAX; i++)
+    {
+      snprintf (name, sizeof name, "read%d", i);
+      ASSERT (filesys_remove (name));
+    }
+
+  printf ("read-bench: PASS\n");
+}
+
+/* Runs THREAD_CNT readers at once and reports the time taken.
+   If SHARED, they all read the same file. */
+static void
+run (int thread_cnt, bool shared)
+{
+  struct reader readers[THREAD_MAX];
+  struct semaphore done;
+  int64_t start;
+  int i;
+
+  sema_init (&done, 0);
+  start = timer_ticks ();
+  for (i = 0; i < thread_cnt; i++)
+    {
+      snprintf (readers[i].name, sizeof readers[i].name, "read%d",
+                shared ? 0 : i);
+      readers[i].done = &done;
+      ASSERT (thread_create ("reader", PRI_DEFAULT, reader_thread,
+                             &readers[i]) != TID_ERROR);
+    }
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&done);
+
+  printf ("%d reader%s, %s: %d bytes in %"PRId64" ticks\n",
+          thread_cnt, thread_cnt > 1 ? "s" : "",
+          shared ? "one file" : "one file each",
+          thread_cnt * ROUND_CNT * FILE_SIZE, timer_elapsed (start));
+}
+
+/* Reads a reader's file ROUND_CNT times. */
+static void
+reader_thread (void *reader_)
+{
+  struct reader *reader = reader_;
+  struct file *file;
+  uint8_t *buf;
+  int round;
+
+  buf = malloc (CHUNK_SIZE);
+  file = filesys_open (reader->name);
+  ASSERT (buf != NULL && file != NULL);
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      file_seek (file, 0);
+      while (file_read (file, buf, CHUNK_SIZE) > 0)
+        continue;
+    }
+  file_close (file);
+  free (buf);
+  sema_up (reader->done);
+}
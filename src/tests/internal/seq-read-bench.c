@@ -0,0 +1,111 @@
+/* Sequential read benchmark for the multi-sector I/O path.
+
+   Writes a FILE_SIZE-byte file, then reads all of it ROUND_CNT
+   times with each of 4 kB, 64 kB and 1 MB requests, and reports
+   the throughput in MB/s for each request size, followed by the
+   block device statistics.  The 1 MB requests are made with
+   file_readv(), as 16 segments of 64 kB.  Whole sectors that are contiguous on
+   disk are read with one device request, so larger requests
+   should be faster, up to the length of the file's extents.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Size of the file to read, in bytes. */
+#define FILE_SIZE (1024 * 1024)
+
+/* Number of times to read the whole file per request size. */
+#define ROUND_CNT 4
+
+/* Size of the buffer that 1 MB requests are scattered over. */
+#define SEGMENT_SIZE (64 * 1024)
+#define SEGMENT_CNT (FILE_SIZE / SEGMENT_SIZE)
+
+static void read_file (struct file *, uint8_t *, size_t request);
+
+/* Times sequential reads of several request sizes. */
+void
+test (void)
+{
+  static const size_t requests[] = {4 * 1024, 64 * 1024, 1024 * 1024};
+  struct file *file;
+  uint8_t *buf;
+  size_t i;
+
+  buf = malloc (SEGMENT_SIZE);
+  ASSERT (buf != NULL);
+  for (i = 0; i < SEGMENT_SIZE; i++)
+    buf[i] = i % 251;
+
+  ASSERT (filesys_create ("seq", 0));
+  file = filesys_open ("seq");
+  ASSERT (file != NULL);
+  for (i = 0; i < SEGMENT_CNT; i++)
+    ASSERT (file_write (file, buf, SEGMENT_SIZE) == SEGMENT_SIZE);
+
+  for (i = 0; i < sizeof requests / sizeof *requests; i++)
+    {
+      int64_t start = timer_ticks ();
+      int64_t ticks;
+      int round;
+
+      for (round = 0; round < ROUND_CNT; round++)
+        read_file (file, buf, requests[i]);
+      ticks = timer_elapsed (start);
+      if (ticks == 0)
+        ticks = 1;
+      printf ("%zu-byte reads: %"PRId64" MB/s\n", requests[i],
+              (int64_t) FILE_SIZE / (1024 * 1024) * ROUND_CNT
+              * TIMER_FREQ / ticks);
+      block_print_stats ();
+    }
+
+  file_close (file);
+  ASSERT (filesys_remove ("seq"));
+  free (buf);
+
+  printf ("seq-read-bench: PASS\n");
+}
+
+/* Reads all of FILE from the start, REQUEST bytes at a time,
+   into BUF, and checks what was read. */
+static void
+read_file (struct file *file, uint8_t *buf, size_t request)
+{
+  off_t ofs;
+
+  file_seek (file, 0);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += request)
+    {
+      size_t i;
+
+      if (request > SEGMENT_SIZE)
+        {
+          struct iovec iov[SEGMENT_CNT];
+
+          for (i = 0; i < SEGMENT_CNT; i++)
+            {
+              iov[i].iov_base = buf;
+              iov[i].iov_len = SEGMENT_SIZE;
+            }
+          ASSERT (file_readv (file, iov, SEGMENT_CNT) == (off_t) request);
+        }
+      else
+        ASSERT (file_read (file, buf, request) == (off_t) request);
+
+      for (i = 0; i < request && i < SEGMENT_SIZE; i++)
+        ASSERT (buf[i] == (ofs + i) % SEGMENT_SIZE % 251);
+    }
+}
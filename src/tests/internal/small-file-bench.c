@@ -0,0 +1,79 @@
+/* Small file benchmark for filesys/inode.c.
+
+   Creates FILE_CNT files of FILE_SIZE bytes each, syncs, then
+   reads them all back, and reports the block device statistics
+   after each phase.  Files this small are kept inside their
+   inodes, so reading one reads a single sector, and writing one
+   writes no data sectors of its own.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/journal.h"
+#include "threads/test.h"
+
+/* Number of files to create. */
+#define FILE_CNT 200
+
+/* Size of each file, in bytes. */
+#define FILE_SIZE 100
+
+/* Counts sector reads and writes for small files. */
+void
+test (void)
+{
+  static char data[FILE_SIZE], buf[FILE_SIZE];
+  char name[NAME_MAX + 1];
+  int i;
+
+  journal_sync ();
+  block_print_stats ();
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      struct file *file;
+
+      snprintf (name, sizeof name, "small%d", i);
+      memset (data, i, sizeof data);
+      ASSERT (filesys_create (name, 0));
+      file = filesys_open (name);
+      ASSERT (file != NULL);
+      ASSERT (file_write (file, data, sizeof data) == sizeof data);
+      file_close (file);
+    }
+  journal_sync ();
+  printf ("after writing %d files of %d bytes:\n", FILE_CNT, FILE_SIZE);
+  block_print_stats ();
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      struct file *file;
+
+      snprintf (name, sizeof name, "small%d", i);
+      memset (data, i, sizeof data);
+      file = filesys_open (name);
+      ASSERT (file != NULL);
+      ASSERT (file_read (file, buf, sizeof buf) == sizeof buf);
+      ASSERT (!memcmp (buf, data, sizeof buf));
+      file_close (file);
+    }
+  printf ("after reading them back:\n");
+  block_print_stats ();
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "small%d", i);
+      ASSERT (filesys_remove (name));
+    }
+
+  printf ("small-file-bench: PASS\n");
+}
@@ -60,8 +60,12 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -simd: Use SSE2 in memcpy() and memset(), if the CPU has it? */
+static bool enable_simd;
+
 static void bss_init (void);
 static void paging_init (void);
+static void simd_init (void);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
@@ -96,6 +100,8 @@ main (void)
   /* Greet user. */
   printf ("PintOS booting with %'"PRIu32" kB RAM...\n",
           init_ram_pages * PGSIZE / 1024);
+  if (enable_simd)
+    simd_init ();
 
   /* Initialize memory system. */
   palloc_init (user_page_limit);
@@ -196,6 +202,51 @@ paging_init (void)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
 }
 
+/* CPUID leaf 1 feature bits, in EDX. */
+#define CPUID_FXSR (1u << 24)   /* FXSAVE and FXRSTOR. */
+#define CPUID_SSE2 (1u << 26)   /* SSE2. */
+
+/* Control register bits. */
+#define CR0_MP 0x00000002       /* Monitor Coprocessor. */
+#define CR0_EM 0x00000004       /* (Floating-point) Emulation. */
+#define CR0_TS 0x00000008       /* Task Switched. */
+#define CR4_OSFXSR 0x00000200   /* OS supports SSE. */
+#define CR4_OSXMMEXCPT 0x00000400 /* OS handles SSE exceptions. */
+
+/* Turns on SSE, if the CPU has SSE2, and lets memcpy() and
+   memset() use it for large blocks.
+
+   start.S sets CR0.EM so that floating-point instructions trap,
+   and SSE instructions fault while it is set, so we clear it.
+   That lets user programs use the FPU and SSE too, although
+   their state is not switched between threads; memcpy() and
+   memset() put back any SSE registers they use.  See [IA32-v3a]
+   13.1.3 "Initialization of the SSE Extensions". */
+static void
+simd_init (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+  uint32_t cr0, cr4;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  if ((edx & (CPUID_FXSR | CPUID_SSE2)) != (CPUID_FXSR | CPUID_SSE2))
+    {
+      printf ("CPU lacks SSE2, not using it.\n");
+      return;
+    }
+
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4));
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  cr0 = (cr0 & ~(CR0_EM | CR0_TS)) | CR0_MP;
+  asm volatile ("movl %0, %%cr0" : : "r" (cr0));
+  asm volatile ("fninit");
+
+  string_sse2 = true;
+  printf ("Using SSE2 in memcpy() and memset().\n");
+}
+
 /* Breaks the kernel command line into words and returns them as
    an argv-like array. */
 static char **
@@ -264,6 +315,8 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-simd"))
+        enable_simd = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -387,6 +440,7 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -simd              Use SSE2 in memcpy() and memset(), if present.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -15,6 +15,9 @@
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
+#ifdef FILESYS
+#include "filesys/directory.h"
+#endif
 
 /* Random value for struct thread's `magic' member.
    Used to detect stack overflow.  See the big comment at the top
@@ -190,6 +193,16 @@ thread_tick (void)
     intr_yield_on_return ();
 }
 
+/* Returns the number of timer ticks spent idle since boot. */
+int64_t
+thread_idle_ticks (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  int64_t t = idle_ticks;
+  intr_set_level (old_level);
+  return t;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
@@ -235,6 +248,12 @@ thread_create (const char *name, int priority,
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
 
+#ifdef FILESYS
+  /* Start in the creator's current directory. */
+  if (thread_current ()->cwd != NULL)
+    t->cwd = dir_reopen (thread_current ()->cwd);
+#endif
+
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
      member cannot be observed. */
@@ -439,6 +458,10 @@ thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
+#ifdef FILESYS
+  dir_close (thread_current ()->cwd);
+  thread_current ()->cwd = NULL;
+#endif
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
@@ -120,6 +120,12 @@ struct thread
     uint32_t *pagedir;                  /* Page directory. */
 #endif
 
+#ifdef FILESYS
+    /* Owned by filesys/filesys.c. */
+    struct dir *cwd;                    /* Current directory, or null
+                                           for the root. */
+#endif
+
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
   };
@@ -136,6 +142,7 @@ size_t threads_sleeping(void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+int64_t thread_idle_ticks (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);